@@ -0,0 +1,389 @@
+#include "ColorLUT.h"
+#include "ParallelTransform.h"
+#include "TransformCache.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define COLOR_LUT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+
+namespace {
+
+constexpr int GridSizes[] = { 33, 65 };
+constexpr char FileMagic[8] = { 'R', 'I', 'P', 'C', 'L', 'U', 'T', '1' };
+
+struct FileHeader {
+    char magic[8];
+    uint32_t grid;
+    uint32_t reserved;
+    double maxDeltaE;
+    double meanDeltaE;
+};
+
+QString cacheDirectory() {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/clut";
+}
+
+QString cacheKey(const QByteArray& inputProfile, const QByteArray& outputProfile, cmsUInt32Number intent, int grid) {
+    return QString("%1_%2_i%3_g%4")
+        .arg(QString::fromLatin1(QCryptographicHash::hash(inputProfile, QCryptographicHash::Sha1).toHex()))
+        .arg(QString::fromLatin1(QCryptographicHash::hash(outputProfile, QCryptographicHash::Sha1).toHex()))
+        .arg(intent)
+        .arg(grid);
+}
+
+// Node offsets of the three corners after the base, walked in order of falling fraction
+struct Tetrahedron {
+    uint32_t step[3];
+    float fraction[3];
+};
+
+inline Tetrahedron tetrahedron(float fr, float fg, float fb, uint32_t sr, uint32_t sg, uint32_t sb) {
+    if (fr >= fg) {
+        if (fg >= fb) return { { sr, sg, sb }, { fr, fg, fb } };
+        if (fr >= fb) return { { sr, sb, sg }, { fr, fb, fg } };
+        return { { sb, sr, sg }, { fb, fr, fg } };
+    }
+    if (fb >= fg) return { { sb, sg, sr }, { fb, fg, fr } };
+    if (fb >= fr) return { { sg, sb, sr }, { fg, fb, fr } };
+    return { { sg, sr, sb }, { fg, fr, fb } };
+}
+
+constexpr float To8Bit = 255.0f / 65535.0f;
+
+// What the interpolation needs from a ColorLUT: nodes, per-axis tables and node strides
+struct Sampler {
+    const uint16_t* nodes;
+    const uint32_t (*offset)[256];
+    const float* fraction;
+    uint32_t sr, sg, sb;
+};
+
+inline Sampler makeSampler(const uint16_t* nodes, const uint32_t (*offset)[256], const float* fraction, int grid) {
+    const uint32_t n = static_cast<uint32_t>(grid);
+    return { nodes, offset, fraction, n * n * 4, n * 4, 4 };
+}
+
+// Base node, the three further corners of the enclosing tetrahedron and their weights
+struct Corners {
+    uint32_t node[4];
+    float weight[3];
+};
+
+inline Corners locate(const Sampler& s, const uint8_t* rgb) {
+    const uint32_t base = s.offset[0][rgb[0]] + s.offset[1][rgb[1]] + s.offset[2][rgb[2]];
+    const Tetrahedron t = tetrahedron(s.fraction[rgb[0]], s.fraction[rgb[1]], s.fraction[rgb[2]], s.sr, s.sg, s.sb);
+
+    Corners c;
+    c.node[0] = base;
+    c.node[1] = base + t.step[0];
+    c.node[2] = c.node[1] + t.step[1];
+    c.node[3] = c.node[2] + t.step[2];
+    std::copy(t.fraction, t.fraction + 3, c.weight);
+    return c;
+}
+
+#ifdef COLOR_LUT_SSE2
+
+// One pixel's CMYK as 8-bit values in the four 32-bit lanes
+inline __m128i interpolate(const Sampler& s, const uint8_t* rgb) {
+    const Corners c = locate(s, rgb);
+    const __m128i zero = _mm_setzero_si128();
+
+    auto node = [&](uint32_t offset) {
+        const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(s.nodes + offset));
+        return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+    };
+
+    const __m128 v0 = node(c.node[0]), v1 = node(c.node[1]), v2 = node(c.node[2]), v3 = node(c.node[3]);
+    __m128 v = v0;
+    v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(c.weight[0]), _mm_sub_ps(v1, v0)));
+    v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(c.weight[1]), _mm_sub_ps(v2, v1)));
+    v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(c.weight[2]), _mm_sub_ps(v3, v2)));
+
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(To8Bit)), _mm_set1_ps(0.5f)));
+}
+
+#else
+
+inline void interpolate(const Sampler& s, const uint8_t* rgb, uint8_t* cmyk) {
+    const Corners c = locate(s, rgb);
+
+    for (int ch = 0; ch < 4; ++ch) {
+        const float v0 = s.nodes[c.node[0] + ch], v1 = s.nodes[c.node[1] + ch];
+        const float v2 = s.nodes[c.node[2] + ch], v3 = s.nodes[c.node[3] + ch];
+        float v = v0;
+        v = v + c.weight[0] * (v1 - v0);
+        v = v + c.weight[1] * (v2 - v1);
+        v = v + c.weight[2] * (v3 - v2);
+        cmyk[ch] = static_cast<uint8_t>(static_cast<int>(v * To8Bit + 0.5f));
+    }
+}
+
+#endif
+
+}
+
+
+std::shared_ptr<const ColorLUT> ColorLUT::forProfiles(const QByteArray& inputProfile, const QByteArray& outputProfile,
+                                                      cmsUInt32Number intent, double maxDeltaE) {
+    static QMutex mutex;
+    static std::map<QString, std::shared_ptr<const ColorLUT>> tables;
+
+    if (inputProfile.isEmpty() || outputProfile.isEmpty())
+        return nullptr;
+
+    QMutexLocker locker(&mutex);
+
+    for (int grid : GridSizes) {
+        const QString key = cacheKey(inputProfile, outputProfile, intent, grid);
+
+        std::shared_ptr<const ColorLUT>& table = tables[key];
+        if (!table) {
+            std::shared_ptr<ColorLUT> lut(new ColorLUT);
+            const QString path = cacheDirectory() + "/" + key + ".clut";
+
+            if (!lut->load(path)) {
+                lut->m_grid = grid;
+                if (!lut->build(inputProfile, outputProfile, intent)) {
+                    tables.erase(key);
+                    return nullptr;
+                }
+                if (lut->measure(inputProfile, outputProfile, intent) && !lut->save(path))
+                    qWarning() << "Could not cache color LUT at" << path;
+            }
+
+            qDebug() << "Color LUT" << grid << "^3: max dE00" << lut->m_maxDeltaE << "mean" << lut->m_meanDeltaE;
+            table = lut;
+        }
+
+        if (table->m_maxDeltaE <= maxDeltaE)
+            return table;
+    }
+
+    qWarning() << "No color LUT within dE00" << maxDeltaE << "of lcms2, using the full transform.";
+    return nullptr;
+}
+
+
+void ColorLUT::prepareAxes() {
+    const uint32_t n = static_cast<uint32_t>(m_grid);
+    const uint32_t stride[3] = { n * n * 4, n * 4, 4 };
+
+    for (int v = 0; v < 256; ++v) {
+        const double position = v * (m_grid - 1) / 255.0;
+        const int node = std::min(static_cast<int>(position), m_grid - 2);
+        m_fraction[v] = static_cast<float>(position - node);
+        for (int axis = 0; axis < 3; ++axis)
+            m_offset[axis][v] = static_cast<uint32_t>(node) * stride[axis];
+    }
+}
+
+
+bool ColorLUT::build(const QByteArray& inputProfile, const QByteArray& outputProfile, cmsUInt32Number intent) {
+    TransformCache::Transform transform = TransformCache::instance().transform(inputProfile, TYPE_RGB_16,
+                                                                               outputProfile, TYPE_CMYK_16,
+                                                                               intent, 0);
+    if (!transform)
+        return false;
+
+    const int n = m_grid;
+    const size_t nodes = static_cast<size_t>(n) * n * n;
+    std::vector<uint16_t> rgb(nodes * 3);
+
+    size_t i = 0;
+    for (int r = 0; r < n; ++r)
+        for (int g = 0; g < n; ++g)
+            for (int b = 0; b < n; ++b) {
+                rgb[i++] = static_cast<uint16_t>(std::lround(r * 65535.0 / (n - 1)));
+                rgb[i++] = static_cast<uint16_t>(std::lround(g * 65535.0 / (n - 1)));
+                rgb[i++] = static_cast<uint16_t>(std::lround(b * 65535.0 / (n - 1)));
+            }
+
+    m_nodes.assign(nodes * 4, 0);
+    if (!parallelTransform(QThreadPool::globalInstance(), transform.get(), rgb.data(), m_nodes.data(), n, n * n))
+        return false;
+    prepareAxes();
+    return true;
+}
+
+
+// Worst and mean CIEDE2000 against lcms2 at every cell centre plus the grey axis
+bool ColorLUT::measure(const QByteArray& inputProfile, const QByteArray& outputProfile, cmsUInt32Number intent) {
+    m_maxDeltaE = m_meanDeltaE = HUGE_VAL;
+
+    TransformCache::Transform reference = TransformCache::instance().transform(inputProfile, TYPE_RGB_8,
+                                                                               outputProfile, TYPE_CMYK_8,
+                                                                               intent, 0);
+    cmsHPROFILE cmyk = cmsOpenProfileFromMem(outputProfile.constData(), static_cast<cmsUInt32Number>(outputProfile.size()));
+    cmsHPROFILE lab = cmsCreateLab4Profile(nullptr);
+    cmsHTRANSFORM toLab = (cmyk && lab)
+        ? cmsCreateTransform(cmyk, TYPE_CMYK_8, lab, TYPE_Lab_DBL, INTENT_RELATIVE_COLORIMETRIC, cmsFLAGS_NOCACHE)
+        : nullptr;
+    if (cmyk) cmsCloseProfile(cmyk);
+    if (lab) cmsCloseProfile(lab);
+
+    if (!reference || !toLab) {
+        if (toLab) cmsDeleteTransform(toLab);
+        qWarning() << "Could not measure color LUT accuracy.";
+        return false;
+    }
+
+    std::vector<uint8_t> rgb;
+    for (int r = 0; r + 1 < m_grid; ++r)
+        for (int g = 0; g + 1 < m_grid; ++g)
+            for (int b = 0; b + 1 < m_grid; ++b) {
+                rgb.push_back(static_cast<uint8_t>(std::lround((r + 0.5) * 255.0 / (m_grid - 1))));
+                rgb.push_back(static_cast<uint8_t>(std::lround((g + 0.5) * 255.0 / (m_grid - 1))));
+                rgb.push_back(static_cast<uint8_t>(std::lround((b + 0.5) * 255.0 / (m_grid - 1))));
+            }
+    for (int v = 0; v < 256; ++v)
+        rgb.insert(rgb.end(), { static_cast<uint8_t>(v), static_cast<uint8_t>(v), static_cast<uint8_t>(v) });
+
+    const int count = static_cast<int>(rgb.size() / 3);
+    std::vector<uint8_t> expected(static_cast<size_t>(count) * 4), actual(static_cast<size_t>(count) * 4);
+    std::vector<cmsCIELab> expectedLab(count), actualLab(count);
+
+    cmsDoTransform(reference.get(), rgb.data(), expected.data(), static_cast<cmsUInt32Number>(count));
+    apply(rgb.data(), actual.data(), count);
+    cmsDoTransform(toLab, expected.data(), expectedLab.data(), static_cast<cmsUInt32Number>(count));
+    cmsDoTransform(toLab, actual.data(), actualLab.data(), static_cast<cmsUInt32Number>(count));
+    cmsDeleteTransform(toLab);
+
+    double worst = 0.0, sum = 0.0;
+    for (int i = 0; i < count; ++i) {
+        const double deltaE = cmsCIE2000DeltaE(&expectedLab[i], &actualLab[i], 1.0, 1.0, 1.0);
+        worst = std::max(worst, deltaE);
+        sum += deltaE;
+    }
+    m_maxDeltaE = worst;
+    m_meanDeltaE = sum / count;
+    return true;
+}
+
+
+void ColorLUT::apply(const uint8_t* rgb, uint8_t* cmyk, int count) const {
+    const Sampler sampler = makeSampler(m_nodes.data(), m_offset, m_fraction, m_grid);
+
+    for (int i = 0; i < count; ++i, rgb += 3, cmyk += 4) {
+#ifdef COLOR_LUT_SSE2
+        const __m128i q = interpolate(sampler, rgb);
+        const __m128i zero = _mm_setzero_si128();
+        const int packed = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(q, zero), zero));
+        std::memcpy(cmyk, &packed, 4);
+#else
+        interpolate(sampler, rgb, cmyk);
+#endif
+    }
+}
+
+
+void ColorLUT::apply(const uint8_t* rgb, uint8_t* const planes[4], int count) const {
+    const Sampler sampler = makeSampler(m_nodes.data(), m_offset, m_fraction, m_grid);
+    uint8_t* c = planes[0];
+    uint8_t* m = planes[1];
+    uint8_t* y = planes[2];
+    uint8_t* k = planes[3];
+
+    int i = 0;
+#ifdef COLOR_LUT_SSE2
+    // Four pixels at a time: transpose the 4x4 CMYK lanes so each plane gets one 32-bit store
+    for (; i + 4 <= count; i += 4, rgb += 12) {
+        const __m128i p0 = interpolate(sampler, rgb);
+        const __m128i p1 = interpolate(sampler, rgb + 3);
+        const __m128i p2 = interpolate(sampler, rgb + 6);
+        const __m128i p3 = interpolate(sampler, rgb + 9);
+
+        const __m128i cm01 = _mm_unpacklo_epi32(p0, p1);     // c0 c1 m0 m1
+        const __m128i cm23 = _mm_unpacklo_epi32(p2, p3);
+        const __m128i yk01 = _mm_unpackhi_epi32(p0, p1);     // y0 y1 k0 k1
+        const __m128i yk23 = _mm_unpackhi_epi32(p2, p3);
+
+        const __m128i cm = _mm_packs_epi32(_mm_unpacklo_epi64(cm01, cm23), _mm_unpackhi_epi64(cm01, cm23));
+        const __m128i yk = _mm_packs_epi32(_mm_unpacklo_epi64(yk01, yk23), _mm_unpackhi_epi64(yk01, yk23));
+        const __m128i bytes = _mm_packus_epi16(cm, yk);      // c0..c3 m0..m3 y0..y3 k0..k3
+
+        const int cv = _mm_cvtsi128_si32(bytes);
+        const int mv = _mm_cvtsi128_si32(_mm_srli_si128(bytes, 4));
+        const int yv = _mm_cvtsi128_si32(_mm_srli_si128(bytes, 8));
+        const int kv = _mm_cvtsi128_si32(_mm_srli_si128(bytes, 12));
+        std::memcpy(c + i, &cv, 4);
+        std::memcpy(m + i, &mv, 4);
+        std::memcpy(y + i, &yv, 4);
+        std::memcpy(k + i, &kv, 4);
+    }
+#endif
+
+    for (; i < count; ++i, rgb += 3) {
+        uint8_t cmyk[4];
+        apply(rgb, cmyk, 1);
+        c[i] = cmyk[0];
+        m[i] = cmyk[1];
+        y[i] = cmyk[2];
+        k[i] = cmyk[3];
+    }
+}
+
+
+bool ColorLUT::load(const QString& localPath) {
+    QFile file(localPath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    FileHeader header {};
+    if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) != qint64(sizeof(header))
+        || std::memcmp(header.magic, FileMagic, sizeof(FileMagic)) != 0
+        || header.grid < 2 || header.grid > 256) {
+        qWarning() << "Ignoring invalid color LUT cache:" << localPath;
+        return false;
+    }
+
+    const size_t values = static_cast<size_t>(header.grid) * header.grid * header.grid * 4;
+    std::vector<uint16_t> nodes(values);
+    const qint64 bytes = static_cast<qint64>(values * sizeof(uint16_t));
+    if (file.read(reinterpret_cast<char*>(nodes.data()), bytes) != bytes || !file.atEnd()) {
+        qWarning() << "Ignoring truncated color LUT cache:" << localPath;
+        return false;
+    }
+
+    m_grid = static_cast<int>(header.grid);
+    m_maxDeltaE = header.maxDeltaE;
+    m_meanDeltaE = header.meanDeltaE;
+    m_nodes = std::move(nodes);
+    prepareAxes();
+    return true;
+}
+
+
+bool ColorLUT::save(const QString& localPath) const {
+    QDir().mkpath(QFileInfo(localPath).absolutePath());
+
+    FileHeader header {};
+    std::memcpy(header.magic, FileMagic, sizeof(FileMagic));
+    header.grid = static_cast<uint32_t>(m_grid);
+    header.maxDeltaE = m_maxDeltaE;
+    header.meanDeltaE = m_meanDeltaE;
+
+    // Written to a temporary and renamed, so a crash never leaves half a table behind
+    QSaveFile file(localPath);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(m_nodes.data()), static_cast<qint64>(m_nodes.size() * sizeof(uint16_t)));
+    return file.commit();
+}
@@ -0,0 +1,56 @@
+// ColorLUT.h
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <lcms2.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+/*******************************************************************************************
+    ColorLUT is an lcms2 RGB -> CMYK transform baked into an N x N x N grid of 16-bit CMYK
+    nodes and evaluated with tetrahedral interpolation (SSE2 on x86, scalar elsewhere;
+    both give identical output).
+
+    forProfiles() builds a 33^3 table first and checks it against lcms2 in CIEDE2000;
+    if it misses the tolerance it tries 65^3, and if that misses too it returns null and
+    the caller keeps using lcms2. Tables are kept in memory and in the user cache
+    directory, keyed by the SHA-1 of both profiles and the intent, so only the first run
+    on a machine pays for building and checking them.
+********************************************************************************************/
+
+class ColorLUT {
+public:
+    static constexpr double DefaultMaxDeltaE = 1.0;
+
+    // Shared table for a profile pair, or null if no grid size reaches maxDeltaE
+    static std::shared_ptr<const ColorLUT> forProfiles(const QByteArray& inputProfile, const QByteArray& outputProfile,
+                                                       cmsUInt32Number intent, double maxDeltaE = DefaultMaxDeltaE);
+
+    // 8-bit RGB in, 8-bit CMYK out, count pixels
+    void apply(const uint8_t* rgb, uint8_t* cmyk, int count) const;
+    void apply(const uint8_t* rgb, uint8_t* const planes[4], int count) const;     // C, M, Y, K planes
+
+    int gridPoints() const { return m_grid; }
+    double maxDeltaE() const { return m_maxDeltaE; }        // Worst CIEDE2000 seen against lcms2
+    double meanDeltaE() const { return m_meanDeltaE; }
+
+private:
+    int m_grid = 0;
+    double m_maxDeltaE = 0.0;
+    double m_meanDeltaE = 0.0;
+    std::vector<uint16_t> m_nodes;                          // CMYK per node, blue fastest
+
+    // Per 8-bit input value: node offset along each axis and fraction to the next node
+    uint32_t m_offset[3][256] = {};
+    float m_fraction[256] = {};
+
+    void prepareAxes();
+    bool build(const QByteArray& inputProfile, const QByteArray& outputProfile, cmsUInt32Number intent);
+    bool measure(const QByteArray& inputProfile, const QByteArray& outputProfile, cmsUInt32Number intent);
+
+    bool load(const QString& localPath);
+    bool save(const QString& localPath) const;
+};
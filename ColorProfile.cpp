@@ -1,18 +1,17 @@
 #include "ColorProfile.h"
+#include "ParallelTransform.h"
+#include "TransformCache.h"
 #include <Magick++.h>
 #include <QFile>
+#include <QThreadPool>
 #include <QUrl>
 #include <QDebug>
-#include <fstream>
 
 
 ColorProfile::ColorProfile(QObject *parent) : QObject(parent) {}
 
 
-ColorProfile::~ColorProfile() {
-    if (inputProfile_)  cmsCloseProfile(inputProfile_);
-    if (outputProfile_) cmsCloseProfile(outputProfile_);
-}
+ColorProfile::~ColorProfile() = default;
 
 
 bool ColorProfile::convertToColorspace(const QString &imagePath, const QString &colorspace) {
@@ -34,13 +33,10 @@ bool ColorProfile::convertToColorspace(const QString &imagePath, const QString &
 
 
 bool ColorProfile::loadProfiles(const QString &inputIccPath, const QString &outputIccPath) {
-    if (inputProfile_) cmsCloseProfile(inputProfile_);
-    if (outputProfile_) cmsCloseProfile(outputProfile_);
-
-    inputProfile_ = cmsOpenProfileFromFile(qPrintable(inputIccPath), "r");
-    outputProfile_ = cmsOpenProfileFromFile(qPrintable(outputIccPath), "r");
+    inputProfile_ = TransformCache::instance().profileData(inputIccPath);
+    outputProfile_ = TransformCache::instance().profileData(outputIccPath);
 
-    if (!inputProfile_ || !outputProfile_) {
+    if (inputProfile_.isEmpty() || outputProfile_.isEmpty()) {
         qWarning() << "Failed to open ICC profiles.";
         return false;
     }
@@ -51,7 +47,7 @@ bool ColorProfile::loadProfiles(const QString &inputIccPath, const QString &outp
 
 
 bool ColorProfile::convertWithICCProfiles(const QString &imagePath, const QString &outputPath) {
-    if (!inputProfile_ || !outputProfile_) {
+    if (inputProfile_.isEmpty() || outputProfile_.isEmpty()) {
         qWarning() << "ICC profiles not loaded.";
         return false;
     }
@@ -71,7 +67,7 @@ bool ColorProfile::convertWithICCProfiles(const QString &imagePath, const QStrin
 
         image.write(0, 0, width, height, "RGB", Magick::CharPixel, inputPixels.data());
 
-        cmsHTRANSFORM transform = cmsCreateTransform(
+        TransformCache::Transform transform = TransformCache::instance().transform(
             inputProfile_, TYPE_RGB_8,
             outputProfile_, TYPE_RGB_8,
             INTENT_PERCEPTUAL, 0);
@@ -81,8 +77,8 @@ bool ColorProfile::convertWithICCProfiles(const QString &imagePath, const QStrin
             return false;
         }
 
-        cmsDoTransform(transform, inputPixels.data(), outputPixels.data(), width * height);
-        cmsDeleteTransform(transform);
+        if (!parallelTransform(QThreadPool::globalInstance(), transform.get(), inputPixels.data(), outputPixels.data(), width, height))
+            return false;
 
         Magick::Image outputImage(Magick::Geometry(width, height), "white");
         outputImage.type(Magick::TrueColorType);
@@ -113,22 +109,20 @@ bool ColorProfile::convertWithICCProfilesCMYK(const QString &imagePath, const QS
         image.profile("icc", Magick::Blob());
 
         // Apply input ICC profile
-        std::ifstream inProfileFile(inputICC.toStdString(), std::ios::binary);
-        if (!inProfileFile) {
+        const QByteArray inProfileData = TransformCache::instance().profileData(inputICC);
+        if (inProfileData.isEmpty()) {
             qWarning() << "❌ Failed to open input ICC profile:" << inputICC;
             return false;
         }
-        std::vector<char> inProfileData((std::istreambuf_iterator<char>(inProfileFile)), {});
-        image.profile("icc", Magick::Blob(inProfileData.data(), inProfileData.size()));
+        image.profile("icc", Magick::Blob(inProfileData.constData(), static_cast<size_t>(inProfileData.size())));
 
         // Apply output ICC profile (this triggers conversion)
-        std::ifstream outProfileFile(outputICC.toStdString(), std::ios::binary);
-        if (!outProfileFile) {
+        const QByteArray outProfileData = TransformCache::instance().profileData(outputICC);
+        if (outProfileData.isEmpty()) {
             qWarning() << "❌ Failed to open output ICC profile:" << outputICC;
             return false;
         }
-        std::vector<char> outProfileData((std::istreambuf_iterator<char>(outProfileFile)), {});
-        image.profile("icc", Magick::Blob(outProfileData.data(), outProfileData.size()));
+        image.profile("icc", Magick::Blob(outProfileData.constData(), static_cast<size_t>(outProfileData.size())));
 
         // Set output format and color space
         image.colorSpace(Magick::CMYKColorspace);
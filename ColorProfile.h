@@ -1,6 +1,7 @@
 #include <QObject>
 #include <QString>
 #include <QVector>
+#include <QByteArray>
 #include <lcms2.h>
 
 
@@ -23,8 +24,8 @@ public:
 
 
 private:
-    cmsHPROFILE inputProfile_ = nullptr;
-    cmsHPROFILE outputProfile_ = nullptr;
+    QByteArray inputProfile_;       // ICC bytes; transforms come from TransformCache
+    QByteArray outputProfile_;
 
     QVector<QVector<uchar>> getPalette(bool useAnsi16) const;
     int findNearestColorIndex(const QVector<uchar> &rgb, const QVector<QVector<uchar>> &palette) const;
@@ -0,0 +1,183 @@
+#include "EditHistory.h"
+#include <QDebug>
+#include <algorithm>
+#include <cstdlib>
+
+
+namespace {
+
+/*
+    Steps [begin, end) through stepAt; a point step is only queued, and the queue runs
+    as one PointKernel pass before the next other step or at the end.
+*/
+template <typename StepAt>
+void replaySteps(Magick::Image& image, int begin, int end, StepAt stepAt, bool fullResolution,
+                 const std::function<void(int)>& progress) {
+    PointKernel kernel;
+    auto flush = [&](int done) {
+        if (kernel.isEmpty())
+            return;
+        kernel.apply(image);
+        kernel.clear();
+        if (progress) progress(done);
+    };
+
+    for (int i = begin; i < end; ++i) {
+        const EditHistory::Step& step = stepAt(i);
+        if (step.point) {
+            kernel.append(*step.point);
+            continue;
+        }
+
+        flush(i - begin);
+        (fullResolution && step.full ? step.full : step.apply)(image);
+        if (progress) progress(i + 1 - begin);
+    }
+    flush(end - begin);
+}
+
+}
+
+
+void EditHistory::reset(const Magick::Image& original) {
+    m_original = original;
+    m_entries.clear();
+    m_position = 0;
+}
+
+
+void EditHistory::push(Step step, const Magick::Image& result, qint64 elapsedMs) {
+    // A new edit after undo discards the steps that were undone
+    m_entries.resize(m_position);
+
+    Entry entry;
+    entry.step = std::move(step);
+    entry.costMs = elapsedMs;
+
+    // Replay cost from the nearest state held as pixels up to this one
+    qint64 replayMs = elapsedMs;
+    for (int i = m_position - 1; i >= 0 && !m_entries[i].checkpoint; --i)
+        replayMs += m_entries[i].costMs;
+
+    if (replayMs >= CheckpointCostMs)
+        entry.checkpoint = result;      // Shares pixels with result until either changes
+
+    m_entries.push_back(std::move(entry));
+    m_position = static_cast<int>(m_entries.size());
+    enforceBudget();
+}
+
+
+// Steps after the current position go, as with push
+void EditHistory::replaceLast(Step step, const Magick::Image& result, qint64 elapsedMs) {
+    if (m_position > 0)
+        --m_position;
+    push(std::move(step), result, elapsedMs);
+}
+
+
+bool EditHistory::undo(Magick::Image& image) {
+    if (!canUndo())
+        return false;
+    if (!restore(m_position - 1, image))
+        return false;
+    --m_position;
+    return true;
+}
+
+
+bool EditHistory::redo(Magick::Image& image) {
+    if (!canRedo())
+        return false;
+
+    const Entry& entry = m_entries[m_position];
+    if (entry.checkpoint) {
+        image = *entry.checkpoint;
+    } else {
+        try {
+            Magick::Image next = image;
+            entry.step.apply(next);
+            image = next;
+        } catch (const Magick::Exception& e) {
+            qWarning() << "Redo of" << entry.step.name << "failed:" << e.what();
+            return false;
+        }
+    }
+    ++m_position;
+    return true;
+}
+
+
+void EditHistory::setMemoryBudget(qint64 bytes) {
+    m_memoryBudget = std::max<qint64>(0, bytes);
+    enforceBudget();
+}
+
+
+qint64 EditHistory::checkpointBytes() const {
+    qint64 bytes = 0;
+    for (const Entry& entry : m_entries)
+        if (entry.checkpoint)
+            bytes += imageBytes(*entry.checkpoint);
+    return bytes;
+}
+
+
+std::vector<EditHistory::Step> EditHistory::appliedSteps() const {
+    std::vector<Step> steps;
+    steps.reserve(m_position);
+    for (int i = 0; i < m_position; ++i)
+        steps.push_back(m_entries[i].step);
+    return steps;
+}
+
+
+void EditHistory::replay(Magick::Image& image, const std::vector<Step>& steps, bool fullResolution,
+                         const std::function<void(int done)>& progress) {
+    replaySteps(image, 0, static_cast<int>(steps.size()),
+                [&steps](int i) -> const Step& { return steps[i]; }, fullResolution, progress);
+}
+
+
+// State after `position` steps: the nearest checkpoint at or before it, then replay forward
+bool EditHistory::restore(int position, Magick::Image& image) const {
+    int start = position;
+    while (start > 0 && !m_entries[start - 1].checkpoint)
+        --start;
+
+    try {
+        Magick::Image state = start > 0 ? *m_entries[start - 1].checkpoint : m_original;
+        replaySteps(state, start, position, [this](int i) -> const Step& { return m_entries[i].step; }, false, nullptr);
+        image = state;
+        return true;
+    } catch (const Magick::Exception& e) {
+        qWarning() << "Restoring edit history failed:" << e.what();
+        return false;
+    }
+}
+
+
+// Drop the checkpoints farthest from the current position until the rest fit the budget
+void EditHistory::enforceBudget() {
+    qint64 bytes = checkpointBytes();
+
+    while (bytes > m_memoryBudget) {
+        int farthest = -1;
+        for (int i = 0; i < static_cast<int>(m_entries.size()); ++i) {
+            if (m_entries[i].checkpoint
+                && (farthest < 0 || std::abs(i + 1 - m_position) > std::abs(farthest + 1 - m_position)))
+                farthest = i;
+        }
+        if (farthest < 0)
+            break;
+
+        bytes -= imageBytes(*m_entries[farthest].checkpoint);
+        m_entries[farthest].checkpoint.reset();
+    }
+}
+
+
+qint64 EditHistory::imageBytes(const Magick::Image& image) {
+    return static_cast<qint64>(image.columns()) * static_cast<qint64>(image.rows())
+           * static_cast<qint64>(image.channels()) * static_cast<qint64>(sizeof(Magick::Quantum));
+}
@@ -0,0 +1,92 @@
+// EditHistory.h
+#pragma once
+
+#include <QString>
+#include <QVariantList>
+#include <Magick++.h>
+#include "PointKernel.h"
+#include <functional>
+#include <optional>
+#include <vector>
+
+
+/*******************************************************************************************
+    EditHistory records every ImageEditor operation with its parameters so edits can be
+    undone and redone without going back to the file on disk.
+
+    Only some states are kept as pixels: the loaded original, and checkpoints taken once
+    replaying the steps since the last one would cost more than CheckpointCostMs. Any
+    other state is rebuilt by replaying forward from the nearest checkpoint at or before
+    it. Snapshots are Magick::Image copies, which share pixels with the live image until
+    one of them is modified.
+
+    Checkpoints other than the original stay under a memory budget; when it is exceeded
+    the checkpoint farthest from the current position is dropped first.
+
+    When the history runs on a proxy, each step also carries the same edit for the
+    full-resolution image; appliedSteps() is what has to be replayed on it.
+
+    Per-pixel steps also carry their PointKernel op. Replays fuse every run of them
+    into one pass over the image, so stacked adjustments cost about as much as one.
+********************************************************************************************/
+
+class EditHistory {
+public:
+    using Operation = std::function<void(Magick::Image&)>;
+
+    struct Step {
+        QString name;                   // ImageEditor method, e.g. "rotate"
+        QVariantList parameters;        // Its arguments, in order
+        Operation apply;
+        Operation full;                 // Same edit at full resolution, when apply runs on a proxy
+        std::optional<PointKernel::Op> point;   // Set when apply is just this per-pixel op
+    };
+
+    static constexpr qint64 DefaultMemoryBudget = qint64(2) << 30;     // 2 GiB of checkpoints
+    static constexpr qint64 CheckpointCostMs = 250;
+
+    // Forget all steps; original becomes the state undo returns to
+    void reset(const Magick::Image& original);
+
+    // Record a step that turned the current state into result, taking elapsedMs to run
+    void push(Step step, const Magick::Image& result, qint64 elapsedMs);
+
+    // Swap the last applied step for one that turned the state before it into result
+    void replaceLast(Step step, const Magick::Image& result, qint64 elapsedMs);
+
+    bool canUndo() const { return m_position > 0; }
+    bool canRedo() const { return m_position < static_cast<int>(m_entries.size()); }
+
+    // Move one step back or forward; image is replaced by that state (false leaves it as is)
+    bool undo(Magick::Image& image);
+    bool redo(Magick::Image& image);
+
+    void setMemoryBudget(qint64 bytes);
+    qint64 checkpointBytes() const;     // Pixels held by checkpoints, original excluded
+    int position() const { return m_position; }
+    int stepCount() const { return static_cast<int>(m_entries.size()); }
+    const Step& step(int index) const { return m_entries[index].step; }
+    bool stateAt(int position, Magick::Image& image) const { return restore(position, image); }   // After `position` steps
+    std::vector<Step> appliedSteps() const;             // Steps 0 .. position, in order
+
+    // Apply steps to image in order, `full` or `apply` of each, fusing runs of point steps;
+    // progress gets the number of steps done. Throws Magick::Exception.
+    static void replay(Magick::Image& image, const std::vector<Step>& steps, bool fullResolution = false,
+                       const std::function<void(int done)>& progress = nullptr);
+
+private:
+    struct Entry {
+        Step step;
+        qint64 costMs = 0;
+        std::optional<Magick::Image> checkpoint;        // State after this step, if kept
+    };
+
+    Magick::Image m_original;
+    std::vector<Entry> m_entries;
+    int m_position = 0;                                 // Steps applied to reach the current state
+    qint64 m_memoryBudget = DefaultMemoryBudget;
+
+    bool restore(int position, Magick::Image& image) const;
+    void enforceBudget();
+    static qint64 imageBytes(const Magick::Image& image);
+};
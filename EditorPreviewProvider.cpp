@@ -0,0 +1,67 @@
+#include "EditorPreviewProvider.h"
+#include "ImageEditor.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <Magick++.h>
+#include <algorithm>
+
+
+EditorPreviewProvider::EditorPreviewProvider(const ImageEditor *editor)
+    : QQuickImageProvider(QQuickImageProvider::Image), m_editor(editor) {}
+
+
+/*
+    Only the id prefix matters: whatever generation is asked for, the latest state is
+    served, so a reload that races an edit still shows the newest image.
+*/
+QImage EditorPreviewProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize) {
+    if (!id.startsWith("preview"))
+        return QImage();
+
+    quint64 generation = 0;
+    Magick::Image preview = m_editor->previewSource(&generation);
+    if (generation == 0 || preview.columns() == 0 || preview.rows() == 0)
+        return QImage();
+
+    QMutexLocker locker(&m_mutex);
+    if (generation == m_cachedGeneration && requestedSize == m_cachedRequest && !m_cached.isNull()) {
+        if (size) *size = m_cached.size();
+        return m_cached;
+    }
+
+    // Fit inside the requested box; a zero side leaves that dimension unconstrained
+    const int columns = static_cast<int>(preview.columns());
+    const int rows = static_cast<int>(preview.rows());
+    const int boxWidth = requestedSize.width() > 0 ? requestedSize.width()
+                         : requestedSize.height() > 0 ? columns : DefaultPreviewSide;
+    const int boxHeight = requestedSize.height() > 0 ? requestedSize.height()
+                          : requestedSize.width() > 0 ? rows : DefaultPreviewSide;
+    const double scale = std::min({ 1.0, static_cast<double>(boxWidth) / columns,
+                                    static_cast<double>(boxHeight) / rows });
+    const int width = std::max(1, static_cast<int>(columns * scale + 0.5));
+    const int height = std::max(1, static_cast<int>(rows * scale + 0.5));
+
+    QImage image(width, height, QImage::Format_RGBA8888);
+    try {
+        // Box-averaging scale is far cheaper than a filtered resize at this size
+        if (width != columns || height != rows) {
+            Magick::Geometry geometry(width, height);
+            geometry.aspect(true);
+            preview.scale(geometry);
+        }
+        if (preview.colorSpace() == Magick::CMYKColorspace)
+            preview.colorSpace(Magick::sRGBColorspace);
+
+        preview.write(0, 0, width, height, "RGBA", Magick::CharPixel, image.bits());
+    } catch (const Magick::Exception &e) {
+        qWarning() << "Failed to render editor preview:" << e.what();
+        return QImage();
+    }
+
+    m_cachedGeneration = generation;
+    m_cachedRequest = requestedSize;
+    m_cached = image;
+
+    if (size) *size = image.size();
+    return image;
+}
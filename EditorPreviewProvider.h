@@ -0,0 +1,36 @@
+// EditorPreviewProvider.h
+#pragma once
+
+#include <QImage>
+#include <QMutex>
+#include <QQuickImageProvider>
+
+class ImageEditor;
+
+
+/*******************************************************************************************
+    EditorPreviewProvider serves the image being edited to QML straight from memory, as
+    image://editor/preview/<generation>. ImageEditor bumps the generation after every
+    change, so the URL changes and the view reloads without a round trip through disk.
+
+    The rendition is 8-bit RGBA, scaled down to fit the requested source size (or
+    DefaultPreviewSide when none is given); the full-resolution image is never copied.
+********************************************************************************************/
+
+class EditorPreviewProvider : public QQuickImageProvider {
+public:
+    static constexpr int DefaultPreviewSide = 2048;
+
+    explicit EditorPreviewProvider(const ImageEditor *editor);
+
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+
+private:
+    const ImageEditor *m_editor;
+
+    // Last rendition, reused while neither the image nor the requested size changes
+    QMutex m_mutex;
+    quint64 m_cachedGeneration = 0;
+    QSize m_cachedRequest;
+    QImage m_cached;
+};
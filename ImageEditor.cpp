@@ -1,25 +1,82 @@
 #include "ImageEditor.h"
+#include "SeparableBlur.h"
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
 #include <QUrl>
 #include <QFile>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
 
 using namespace Magick;
 
 
+namespace {
+
+// A full-resolution length on an image `scale` times as large; sizes never drop below 1
+ssize_t scaledOffset(double value, double scale) { return static_cast<ssize_t>(std::lround(value * scale)); }
+size_t scaledSize(double value, double scale) { return static_cast<size_t>(std::max(1L, std::lround(value * scale))); }
+
+}
+
+
 /*****************************************************
     ImageEditor constructor, Initializes ImageMagick.
 *****************************************************/
 ImageEditor::ImageEditor(QObject *parent) : QObject(parent) {
     InitializeMagick(nullptr);
+
+    m_worker.setMaxThreadCount(1);
+
+    connect(&m_saveWatcher, &QFutureWatcher<bool>::finished, this, [this]() {
+        emit savingChanged();
+        emit saveFinished(m_saveWatcher.result(), m_savePath);
+    });
+    connect(&m_jobWatcher, &QFutureWatcher<JobResult>::finished, this, &ImageEditor::finishJob);
 }
 
 
-// Load an image from the provided file path
+// Work in progress owns a copy of everything it needs, but its signals target this
+ImageEditor::~ImageEditor() {
+    cancel();
+    m_jobWatcher.disconnect(this);
+    m_saveWatcher.disconnect(this);
+    m_worker.waitForDone();
+    m_saveWatcher.waitForFinished();
+}
+
+
+// Load an image from the provided file path; edits then run on a proxy of it
 bool ImageEditor::loadImage(const QString &path) {
+    cancel();
+    if (!m_deferredSavePath.isEmpty()) {
+        const QString deferred = m_deferredSavePath;
+        m_deferredSavePath.clear();
+        emit savingChanged();
+        emit saveFinished(false, deferred);
+    }
+
     try {
         QString localPath = QUrl(path).toLocalFile();
-        m_image.read(localPath.toStdString());
+        m_fullImage.read(localPath.toStdString());
+
+        // Box-averaged once here, so every later edit and preview works on the small copy
+        m_image = m_fullImage;
+        const size_t longest = std::max(m_fullImage.columns(), m_fullImage.rows());
+        m_proxyScale = std::min(1.0, static_cast<double>(m_proxySide) / longest);
+        if (m_proxyScale < 1.0) {
+            Geometry geometry(scaledSize(m_fullImage.columns(), m_proxyScale),
+                              scaledSize(m_fullImage.rows(), m_proxyScale));
+            geometry.aspect(true);
+            m_image.scale(geometry);
+        }
+
+        m_history.reset(m_image);
+        m_adjustBase = Image();
+        m_adjustPosition = -1;
         m_imageLoaded = true;
+        publishPreview();
         return true;
     } catch (const Magick::Exception &e) {
         qWarning() << "Failed to load image:" << e.what();
@@ -29,15 +86,21 @@ bool ImageEditor::loadImage(const QString &path) {
 }
 
 
-// Save the currently loaded image to a specified output path
+// Save the currently loaded image to a specified output path, at full resolution
 bool ImageEditor::saveImage(const QString &outputPath) {
     if (!m_imageLoaded) {
         qWarning() << "No image loaded.";
         return false;
     }
+
+    // Without a proxy the working image already is the full-resolution state
+    Image result = m_image;
+    if (m_proxyScale < 1.0 && !renderFullResolution(m_fullImage, m_history.appliedSteps(), result))
+        return false;
+
     try {
         QString localPath = QUrl(outputPath).toLocalFile();
-        m_image.write(localPath.toStdString());
+        result.write(localPath.toStdString());
         return true;
     } catch (const Magick::Exception &e) {
         qWarning() << "Failed to save image:" << e.what();
@@ -46,7 +109,72 @@ bool ImageEditor::saveImage(const QString &outputPath) {
 }
 
 
-// Delete a file from disk, used to delete the temporary image used in editing
+/*
+    Same as saveImage, but the replay and the encoding run on the global thread pool
+    with their own copies of the images and steps, so editing can go on meanwhile.
+    saveProgress reports steps replayed, with the write counted as the last one.
+    While edits are still queued the save waits for them, so it includes them.
+*/
+bool ImageEditor::saveImageAsync(const QString &outputPath) {
+    if (!m_imageLoaded || isSaving())
+        return false;
+
+    if (m_running) {
+        m_deferredSavePath = outputPath;
+        emit savingChanged();
+        return true;
+    }
+
+    const Image working = m_image;
+    const Image original = m_fullImage;
+    const bool replay = m_proxyScale < 1.0;
+    const std::vector<EditHistory::Step> steps = replay ? m_history.appliedSteps() : std::vector<EditHistory::Step>();
+    const QString localPath = QUrl(outputPath).toLocalFile();
+    m_savePath = outputPath;
+
+    m_saveWatcher.setFuture(QtConcurrent::run([this, working, original, replay, steps, localPath]() {
+        const double total = static_cast<double>(steps.size() + 1);
+        Image result = working;
+        if (replay && !renderFullResolution(original, steps, result,
+                                            [this, total](int done) { emit saveProgress(done / total); }))
+            return false;
+
+        try {
+            result.write(localPath.toStdString());
+        } catch (const Magick::Exception &e) {
+            qWarning() << "Failed to save image:" << e.what();
+            return false;
+        }
+        emit saveProgress(1.0);
+        return true;
+    }));
+    emit savingChanged();
+    return true;
+}
+
+
+// Longest side of the proxy edits run on; usually the preview viewport in device pixels
+void ImageEditor::setProxySize(int maxSide) {
+    m_proxySide = std::max(1, maxSide);
+}
+
+
+// original with steps replayed at full resolution; touches no members, so any thread may call it
+bool ImageEditor::renderFullResolution(const Image &original, const std::vector<EditHistory::Step> &steps,
+                                       Image &result, const std::function<void(int done)> &progress) {
+    try {
+        Image state = original;
+        EditHistory::replay(state, steps, true, progress);
+        result = state;
+        return true;
+    } catch (const Magick::Exception &e) {
+        qWarning() << "Replaying edits at full resolution failed:" << e.what();
+        return false;
+    }
+}
+
+
+// Delete a file from disk
 bool ImageEditor::deleteFile(const QString &path) {
     QString localPath = QUrl(path).toLocalFile();
 
@@ -65,257 +193,416 @@ bool ImageEditor::deleteFile(const QString &path) {
 }
 
 
-// Resize the image to specified width and height
-bool ImageEditor::resizeImage(int width, int height) {
+// URL of the current state; changes after every load, edit, undo and redo
+QString ImageEditor::previewUrl() const {
+    QMutexLocker locker(&m_previewMutex);
+    return m_generation ? QString("image://editor/preview/%1").arg(m_generation) : QString();
+}
+
+
+Magick::Image ImageEditor::previewSource(quint64 *generation) const {
+    QMutexLocker locker(&m_previewMutex);
+    if (generation) *generation = m_generation;
+    return m_previewImage;
+}
+
+
+// Hand the current image to the preview provider and let QML reload it
+void ImageEditor::publishPreview() {
+    {
+        QMutexLocker locker(&m_previewMutex);
+        m_previewImage = m_image;
+        ++m_generation;
+    }
+    emit previewChanged();
+}
+
+
+// operation gets the size of its target relative to the full-resolution image and scales pixel parameters by it
+bool ImageEditor::applyEdit(const QString &name, const QVariantList &parameters, const ScaledOperation &operation) {
+    const double scale = m_proxyScale;
+    return enqueueStep({ name, parameters,
+                        [operation, scale](Image &image) { operation(image, scale); },
+                        [operation](Image &image) { operation(image, 1.0); },
+                        std::nullopt });
+}
+
+
+// Per-pixel edits run through PointKernel, so replays can fuse a run of them into one pass
+bool ImageEditor::applyPointEdit(const QString &name, const QVariantList &parameters, const PointKernel::Op &op) {
+    auto operation = [op](Image &image) {
+        PointKernel kernel;
+        kernel.append(op);
+        kernel.apply(image);
+    };
+    return enqueueStep({ name, parameters, operation, operation, op }, true);
+}
+
+
+/*
+    Every edit runs through here. Since an adjustment replaces the previous value of
+    its slider rather than stacking on it, a pending request for the same adjustment
+    is superseded: a queued one is replaced, a running one is aborted, so a dragged
+    slider only ever has its latest value computed. Other edits always queue.
+*/
+bool ImageEditor::enqueueStep(EditHistory::Step step, bool adjustment) {
     if (!m_imageLoaded) return false;
 
-    try {
-        m_image.resize(Geometry(width, height));
-        return true;
-    } catch (const Magick::Exception &e) {
-        qWarning() << "Resize failed:" << e.what();
+    auto job = std::make_shared<Job>();
+    job->step = std::move(step);
+    job->adjustment = adjustment;
+    job->editor = this;
+
+    if (adjustment) {
+        if (!m_queue.empty() && m_queue.back()->adjustment && m_queue.back()->step.name == job->step.name) {
+            m_queue.back() = job;
+            return true;
+        }
+        if (m_queue.empty() && m_running && m_running->adjustment && m_running->step.name == job->step.name)
+            m_running->cancelled = true;
+    }
+
+    m_queue.push_back(job);
+    if (!m_running)
+        startNextJob();
+    return true;
+}
+
+
+// Run the next queued edit on the current image; finishJob picks up the result
+void ImageEditor::startNextJob() {
+    const bool wasBusy = isBusy();
+    m_running.reset();
+
+    if (!m_queue.empty()) {
+        m_running = m_queue.front();
+        m_queue.pop_front();
+        m_running->base = m_image;
+        if (m_running->adjustment)
+            m_running->replacesLast = adjustmentBase(m_running->step.name, m_running->base);
+        m_jobWatcher.setFuture(QtConcurrent::run(&m_worker, &ImageEditor::runJob, m_running, m_running->base));
+    }
+
+    setProgress(m_running.get(), 0.0);
+    if (wasBusy != isBusy())
+        emit busyChanged();
+}
+
+
+/*
+    If the history's last entry is the same adjustment, base becomes the state before
+    it. That state is kept while the entry stays on top, so a drag rebuilds it once.
+*/
+bool ImageEditor::adjustmentBase(const QString &name, Image &base) {
+    const int position = m_history.position();
+    if (position == 0 || m_history.step(position - 1).name != name)
         return false;
+
+    if (m_adjustPosition != position) {
+        Image state;
+        if (!m_history.stateAt(position - 1, state))
+            return false;
+        m_adjustBase = state;
+        m_adjustPosition = position;
     }
+    base = m_adjustBase;
+    return true;
 }
 
 
-// Rotate image by a given number of degrees
-bool ImageEditor::rotate(double degrees) {
-    if (!m_imageLoaded) return false;
+/*
+    On the worker: the step is applied to a copy of the image, so a failure or an abort
+    leaves the image untouched. ImageMagick and SeparableBlur report progress through
+    monitorJob, which also aborts the operation once the job is cancelled.
+*/
+ImageEditor::JobResult ImageEditor::runJob(const std::shared_ptr<Job> &job, const Image &base) {
+    JobResult result;
+    if (job->cancelled)
+        return result;
 
     try {
-        m_image.rotate(degrees);
+        QElapsedTimer timer;
+        timer.start();
+
+        // Own copy first: image() alone would install the monitor on base, which the
+        // history and the preview share and which outlives this job
+        Image edited = base;
+        edited.modifyImage();
+        MagickCore::SetImageProgressMonitor(edited.image(), &ImageEditor::monitorJob, job.get());
+        job->step.apply(edited);
+
+        // The result is kept in the history long after this job is gone
+        MagickCore::SetImageProgressMonitor(edited.image(), nullptr, nullptr);
+
+        result.success = !job->cancelled;
+        result.image = edited;
+        result.elapsedMs = timer.elapsed();
+    } catch (const Magick::Exception &e) {
+        if (!job->cancelled)
+            qWarning() << job->step.name << "failed:" << e.what();
+    }
+    return result;
+}
+
+
+// Called by ImageMagick from its own threads; returning false aborts the operation
+MagickCore::MagickBooleanType ImageEditor::monitorJob(const char *, MagickCore::MagickOffsetType offset,
+                                                      MagickCore::MagickSizeType extent, void *data) {
+    Job *job = static_cast<Job *>(data);
+    if (job->cancelled)
+        return MagickCore::MagickFalse;
+
+    const int percent = extent > 0 ? static_cast<int>(100 * (offset + 1) / static_cast<double>(extent)) : 0;
+    if (job->percent.exchange(percent) != percent) {
+        ImageEditor *editor = job->editor;
+        QMetaObject::invokeMethod(editor, [editor, job, percent]() {
+            editor->setProgress(job, std::min(percent, 100) / 100.0);
+        }, Qt::QueuedConnection);
+    }
+    return MagickCore::MagickTrue;
+}
+
+
+// Back on the GUI thread: record the finished edit and move on to the next
+void ImageEditor::finishJob() {
+    const std::shared_ptr<Job> job = m_running;
+    const JobResult result = m_jobWatcher.result();
+
+    if (job && !job->cancelled) {
+        if (result.success) {
+            m_image = result.image;
+            if (job->replacesLast)
+                m_history.replaceLast(job->step, m_image, result.elapsedMs);
+            else
+                m_history.push(job->step, m_image, result.elapsedMs);
+
+            // Only an adjustment on top can be replaced by the next value of its slider
+            m_adjustBase = job->adjustment ? job->base : Image();
+            m_adjustPosition = job->adjustment ? m_history.position() : -1;
+            publishPreview();
+        }
+        emit operationFinished(job->step.name, result.success);
+    }
+
+    startNextJob();
+
+    if (!m_running && !m_deferredSavePath.isEmpty()) {
+        const QString path = m_deferredSavePath;
+        m_deferredSavePath.clear();
+        if (!saveImageAsync(path)) {
+            emit savingChanged();
+            emit saveFinished(false, path);
+        }
+    }
+}
+
+
+// Progress of the running edit; reports from a job that has since finished are ignored
+void ImageEditor::setProgress(const Job *job, double fraction) {
+    if (job != m_running.get() || fraction == m_progress)
+        return;
+    m_progress = fraction;
+    emit progressChanged();
+}
+
+
+void ImageEditor::cancel() {
+    m_queue.clear();
+    if (m_running)
+        m_running->cancelled = true;
+}
+
+
+// Step back to the state before the last edit; edits not yet finished are what gets undone first
+bool ImageEditor::undo() {
+    if (m_running) {
+        cancel();
         return true;
-    } catch (...) {
-        return false;
     }
+    if (!m_imageLoaded || !m_history.undo(m_image))
+        return false;
+    publishPreview();
+    return true;
+}
+
+
+// Reapply the last undone edit
+bool ImageEditor::redo() {
+    if (m_running || !m_imageLoaded || !m_history.redo(m_image))
+        return false;
+    publishPreview();
+    return true;
+}
+
+
+// Memory allowed for undo checkpoints besides the original image
+void ImageEditor::setHistoryMemoryLimit(int megabytes) {
+    m_history.setMemoryBudget(static_cast<qint64>(megabytes) << 20);
+}
+
+
+// Resize the image to specified width and height
+bool ImageEditor::resizeImage(int width, int height) {
+    return applyEdit("resizeImage", { width, height }, [=](Image &image, double scale) {
+        image.resize(Geometry(scaledSize(width, scale), scaledSize(height, scale)));
+    });
+}
+
+
+// Rotate image by a given number of degrees
+bool ImageEditor::rotate(double degrees) {
+    return applyEdit("rotate", { degrees }, [=](Image &image, double) {
+        image.rotate(degrees);
+    });
 }
 
 
 // Flip the image horizontally or vertically
 bool ImageEditor::flip(const QString &direction) {
-    if (!m_imageLoaded) return false;
+    if (direction != "horizontal" && direction != "vertical")
+        return false;
 
-    try {
+    return applyEdit("flip", { direction }, [=](Image &image, double) {
         if (direction == "horizontal")
-            m_image.flop();
-        else if (direction == "vertical")
-            m_image.flip();
+            image.flop();
         else
-            return false;
-        return true;
-    } catch (...) {
-        return false;
-    }
+            image.flip();
+    });
 }
 
 
 // Crop the image to a specific rectangle (x, y, width, height)
 bool ImageEditor::crop(int x, int y, int width, int height) {
-    if (!m_imageLoaded) return false;
-
-    try {
-        m_image.crop(Magick::Geometry(width, height, x, y));
-        return true;
-    } catch (...) {
-        return false;
-    }
+    return applyEdit("crop", { x, y, width, height }, [=](Image &image, double scale) {
+        image.crop(Geometry(scaledSize(width, scale), scaledSize(height, scale),
+                            scaledOffset(x, scale), scaledOffset(y, scale)));
+    });
 }
 
 
 // Adjust image brightness and contrast
 bool ImageEditor::adjustBrightnessContrast(int brightness, int contrast) {
-    if (!m_imageLoaded) return false;
-
-    try {
-        double b = 100.0 + brightness;
-        double s = 100.0;               // keep saturation constant
-        double h = 100.0 + contrast;    // simulate contrast via hue adjustment (optional)
-        m_image.modulate(b, s, h);
-        return true;
-    } catch (const Magick::Exception &e) {
-        qWarning() << "Brightness/Contrast adjustment failed:" << e.what();
-        return false;
-    }
+    double b = 100.0 + brightness;
+    double s = 100.0;               // keep saturation constant
+    double h = 100.0 + contrast;    // simulate contrast via hue adjustment (optional)
+    return applyPointEdit("adjustBrightnessContrast", { brightness, contrast }, PointKernel::modulate(b, s, h));
 }
 
 
-// Resize image to its original dimensions
+// Resize image to its original dimensions; base size is kept through the proxy scale
 bool ImageEditor::resizeToOriginal() {
-    if (!m_imageLoaded) return false;
-    try {
-        Geometry originalSize(m_image.baseColumns(), m_image.baseRows());
-        m_image.resize(originalSize);
-        return true;
-    } catch (...) {
-        return false;
-    }
+    return applyEdit("resizeToOriginal", {}, [](Image &image, double scale) {
+        image.resize(Geometry(scaledSize(image.baseColumns(), scale), scaledSize(image.baseRows(), scale)));
+    });
 }
 
 
 // Resize image to half its current size
 bool ImageEditor::resizeToHalf() {
-    if (!m_imageLoaded) return false;
-    try {
-        m_image.resize(Geometry(m_image.columns() / 2, m_image.rows() / 2));
-        return true;
-    } catch (...) {
-        return false;
-    }
+    return applyEdit("resizeToHalf", {}, [](Image &image, double) {
+        image.resize(Geometry(image.columns() / 2, image.rows() / 2));
+    });
 }
 
 
 // Resize image to double its current size
 bool ImageEditor::resizeToDouble() {
-    if (!m_imageLoaded) return false;
-    try {
-        m_image.resize(Geometry(m_image.columns() * 2, m_image.rows() * 2));
-        return true;
-    } catch (...) {
-        return false;
-    }
+    return applyEdit("resizeToDouble", {}, [](Image &image, double) {
+        image.resize(Geometry(image.columns() * 2, image.rows() * 2));
+    });
 }
 
 
 // Adjust image hue level
 bool ImageEditor::adjustHue(int hue) {
-    if (!m_imageLoaded) return false;
-    try {
-        m_image.modulate(100.0, 100.0, 100.0 + hue);
-        return true;
-    } catch (...) {
-        return false;
-    }
+    return applyPointEdit("adjustHue", { hue }, PointKernel::modulate(100.0, 100.0, 100.0 + hue));
 }
 
 
 // Adjust image saturation level
 bool ImageEditor::adjustSaturation(int saturation) {
-    if (!m_imageLoaded) return false;
-    try {
-        m_image.modulate(100.0, 100.0 + saturation, 100.0);
-        return true;
-    } catch (...) {
-        return false;
-    }
+    return applyPointEdit("adjustSaturation", { saturation }, PointKernel::modulate(100.0, 100.0 + saturation, 100.0));
 }
 
 
 // Apply gamma correction
 bool ImageEditor::adjustGamma(double gamma) {
-    if (!m_imageLoaded) return false;
-    try {
-        m_image.gamma(gamma);
-        return true;
-    } catch (...) {
-        return false;
-    }
+    return applyPointEdit("adjustGamma", { gamma }, PointKernel::gamma(gamma));
 }
 
 
-// Apply sharpening effect using radius and sigma
+// Apply sharpening effect using radius and sigma, in full-resolution pixels
 bool ImageEditor::sharpenImage(double radius, double sigma) {
-    if (!m_imageLoaded) return false;
-    try {
-        m_image.sharpen(radius, sigma);
-        return true;
-    } catch (...) {
-        return false;
-    }
+    return applyEdit("sharpenImage", { radius, sigma }, [=](Image &image, double scale) {
+        const double r = radius * scale, s = std::max(sigma * scale, 0.1);
+        if (!SeparableBlur::sharpen(image, r, s))
+            image.sharpen(r, s);
+    });
 }
 
 
-// Apply Gaussian blur using radius and sigma
+// Apply Gaussian blur using radius and sigma, in full-resolution pixels
 bool ImageEditor::applyBlur(double radius, double sigma) {
-    if (!m_imageLoaded) return false;
-    try {
-        m_image.blur(radius, sigma);
-        return true;
-    } catch (...) {
-        return false;
-    }
+    return applyEdit("applyBlur", { radius, sigma }, [=](Image &image, double scale) {
+        const double r = radius * scale, s = std::max(sigma * scale, 0.1);
+        if (!SeparableBlur::blur(image, r, s))
+            image.blur(r, s);
+    });
 }
 
 
 // Apply sepia tone effect to image
 bool ImageEditor::applySepia(double threshold) {
-    if (!m_imageLoaded) return false;
-    try {
-        m_image.sepiaTone(threshold);
-        return true;
-    } catch (...) {
-        return false;
-    }
+    return applyEdit("applySepia", { threshold }, [=](Image &image, double) {
+        image.sepiaTone(threshold);
+    });
 }
 
 
 // Apply vignette effect
 bool ImageEditor::applyVignette() {
-    if (!m_imageLoaded) return false;
-    try {
-        m_image.vignette();
-        return true;
-    } catch (...) {
-        return false;
-    }
+    return applyEdit("applyVignette", {}, [](Image &image, double) {
+        image.vignette();
+    });
 }
 
 
 // Apply swirl distortion effect
 bool ImageEditor::applySwirl(double degrees) {
-    if (!m_imageLoaded) return false;
-    try {
-        m_image.swirl(degrees);
-        return true;
-    } catch (...) {
-        return false;
-    }
+    return applyEdit("applySwirl", { degrees }, [=](Image &image, double) {
+        image.swirl(degrees);
+    });
 }
 
 
 // Apply implode effect using a distortion factor
 bool ImageEditor::applyImplode(double factor) {
-    if (!m_imageLoaded) return false;
-    try {
-        m_image.implode(factor);
-        return true;
-    } catch (...) {
-        return false;
-    }
+    return applyEdit("applyImplode", { factor }, [=](Image &image, double) {
+        image.implode(factor);
+    });
 }
 
 
 // Draw text on the image at specified coordinates
 bool ImageEditor::drawText(const QString &text, int x, int y) {
-    if (!m_imageLoaded) return false;
-
-    try {
+    return applyEdit("drawText", { text, x, y }, [=](Image &image, double scale) {
         DrawableList drawList;
         drawList.push_back(DrawableFont("Arial"));
-        drawList.push_back(DrawablePointSize(24));
-        drawList.push_back(DrawableText(x, y, text.toStdString()));
+        drawList.push_back(DrawablePointSize(24 * scale));
+        drawList.push_back(DrawableText(x * scale, y * scale, text.toStdString()));
         drawList.push_back(DrawableFillColor("white"));
-        m_image.draw(drawList);
-        return true;
-    } catch (const Magick::Exception &e) {
-        qWarning() << "Draw text failed:" << e.what();
-        return false;
-    }
+        image.draw(drawList);
+    });
 }
 
 
 // Draw a rectangle at (x, y) with width and height
 bool ImageEditor::drawRectangle(int x, int y, int w, int h) {
-    if (!m_imageLoaded) return false;
-
-    try {
-        Magick::DrawableList drawList;
-        drawList.push_back(Magick::DrawableStrokeColor("red"));
-        drawList.push_back(Magick::DrawableFillColor("none"));
-        drawList.push_back(Magick::DrawableRectangle(x, y, x + w, y + h));
-        m_image.draw(drawList);
-        return true;
-    } catch (...) {
-        return false;
-    }
+    return applyEdit("drawRectangle", { x, y, w, h }, [=](Image &image, double scale) {
+        DrawableList drawList;
+        drawList.push_back(DrawableStrokeColor("red"));
+        drawList.push_back(DrawableFillColor("none"));
+        drawList.push_back(DrawableRectangle(x * scale, y * scale, (x + w) * scale, (y + h) * scale));
+        image.draw(drawList);
+    });
 }
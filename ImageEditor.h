@@ -1,23 +1,59 @@
+#include <QFutureWatcher>
+#include <QMutex>
 #include <QObject>
 #include <QString>
+#include <QThreadPool>
+#include <QVariantList>
 #include <Magick++.h>
+#include "EditHistory.h"
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
 
 
 
 /***************************************************************************
     ImageEditor provides image manipulation capabilities using ImageMagick.
-    Exposed to QML through Q_INVOKABLE methods.
+    Exposed to QML through Q_INVOKABLE methods; the current image is shown
+    through previewUrl, served from memory by EditorPreviewProvider.
+
+    Edits run on a proxy no larger than the preview, so sliders answer at
+    screen resolution whatever the file size. Coordinates and sizes passed
+    in are full-resolution pixels and are scaled to the proxy. The recorded
+    steps are replayed on the full-resolution image only when it is saved.
+
+    Edits are queued and run one at a time on a worker thread; the edit
+    calls return as soon as the step is queued. busy, progress and
+    operationFinished report on the queue; cancel() empties it.
+
+    Slider adjustments (hue, saturation, gamma, brightness/contrast) are
+    absolute: a new value for the operation on top of the history replaces
+    that entry, computed from the state before it, so a drag leaves one undo
+    step and its result depends only on the final value. That is what lets a
+    new value replace a queued one, or abort a running one, of the same
+    slider, so only the latest value of a drag is computed.
 ****************************************************************************/
 
 class ImageEditor : public QObject {
     Q_OBJECT
+    Q_PROPERTY(QString previewUrl READ previewUrl NOTIFY previewChanged)
+    Q_PROPERTY(bool saving READ isSaving NOTIFY savingChanged)
+    Q_PROPERTY(bool busy READ isBusy NOTIFY busyChanged)
+    Q_PROPERTY(double progress READ progress NOTIFY progressChanged)
 
 public:
+    static constexpr int DefaultProxySide = 2048;
+
     explicit ImageEditor(QObject *parent = nullptr);
+    ~ImageEditor() override;
 
     // Image I/O operations
     Q_INVOKABLE bool loadImage(const QString &path);                        // Load image from file
-    Q_INVOKABLE bool saveImage(const QString &outputPath);                  // Save image to file
+    Q_INVOKABLE bool saveImage(const QString &outputPath);                  // Save finished edits to file, blocking
+    Q_INVOKABLE bool saveImageAsync(const QString &outputPath);             // Save once queued edits are done, see saveFinished
+    Q_INVOKABLE void setProxySize(int maxSide);                             // Proxy longest side, from the next load
     Q_INVOKABLE bool deleteFile(const QString &path);                       // Delete file from disk
 
     // Transformations
@@ -45,15 +81,98 @@ public:
     Q_INVOKABLE bool applySwirl(double degrees);                            // Apply swirl distortion
     Q_INVOKABLE bool applyImplode(double factor);                           // Apply implode effect
 
+    // Queue
+    Q_INVOKABLE void cancel();                                              // Drop queued edits, abort the running one
+
+    // History; every edit above is recorded with its parameters
+    Q_INVOKABLE bool undo();                                                // Cancel pending edits, or step back one
+    Q_INVOKABLE bool redo();                                                // Reapply the last undone edit
+    Q_INVOKABLE bool canUndo() const { return m_history.canUndo(); }
+    Q_INVOKABLE bool canRedo() const { return m_history.canRedo(); }
+    Q_INVOKABLE void setHistoryMemoryLimit(int megabytes);                 // Undo checkpoints, original excluded
+
     // Drawing functions
     Q_INVOKABLE bool drawText(const QString &text, int x, int y);           // Draw text at (x, y)
     Q_INVOKABLE bool drawRectangle(int x, int y, int width, int height);    // Draw rectangle at (x, y)
 
-    // Accessor
+    // Accessors
     QString currentImagePath() const { return imagePath; }
+    QString previewUrl() const;                                             // image://editor/preview/<generation>
+    bool isSaving() const { return m_saveWatcher.isRunning() || !m_deferredSavePath.isEmpty(); }
+    bool isBusy() const { return m_running != nullptr; }
+    double progress() const { return m_progress; }
+
+    // Snapshot of the current image for the preview provider; safe from any thread.
+    // generation is 0 until an image has been loaded.
+    Magick::Image previewSource(quint64 *generation = nullptr) const;
+
+signals:
+    void previewChanged();
+    void savingChanged();
+    void saveProgress(double fraction);                                     // From the saving thread
+    void saveFinished(bool success, const QString &outputPath);
+    void busyChanged();
+    void progressChanged();
+    void operationFinished(const QString &name, bool success);              // Not emitted for cancelled edits
 
 private:
-    Magick::Image m_image;
+    using ScaledOperation = std::function<void(Magick::Image &, double scale)>;
+
+    Magick::Image m_image;                  // Proxy that edits and the preview work on
+    Magick::Image m_fullImage;              // Full-resolution image as loaded
+    double m_proxyScale = 1.0;              // m_image pixels per full-resolution pixel
+    int m_proxySide = DefaultProxySide;
     QString imagePath;
     bool m_imageLoaded = false;
+    EditHistory m_history;
+
+    // Shares pixels with m_image; replaced, never modified, after each change
+    mutable QMutex m_previewMutex;
+    Magick::Image m_previewImage;
+    quint64 m_generation = 0;
+
+    QFutureWatcher<bool> m_saveWatcher;
+    QString m_savePath;                     // As given to saveImageAsync, for saveFinished
+    QString m_deferredSavePath;             // Save requested while edits were pending
+
+    // An edit waiting for or running on m_worker
+    struct Job {
+        EditHistory::Step step;
+        bool adjustment = false;            // Slider value, see above
+        bool replacesLast = false;          // Set when it starts: replaces the history's last entry
+        Magick::Image base;                 // State it runs on, set when it starts
+        std::atomic_bool cancelled { false };
+        std::atomic_int percent { -1 };     // Last progress reported, to throttle the monitor
+        ImageEditor *editor = nullptr;
+    };
+
+    struct JobResult {
+        bool success = false;
+        Magick::Image image;
+        qint64 elapsedMs = 0;
+    };
+
+    QThreadPool m_worker;                   // One thread, so edits run in order
+    std::deque<std::shared_ptr<Job>> m_queue;
+    std::shared_ptr<Job> m_running;
+    QFutureWatcher<JobResult> m_jobWatcher;
+    double m_progress = 0.0;
+
+    // State the adjustment on top of the history was computed from, while it is on top
+    Magick::Image m_adjustBase;
+    int m_adjustPosition = -1;              // History position with that entry on top, -1 if none
+
+    void publishPreview();
+    bool applyEdit(const QString &name, const QVariantList &parameters, const ScaledOperation &operation);
+    bool applyPointEdit(const QString &name, const QVariantList &parameters, const PointKernel::Op &op);
+    bool enqueueStep(EditHistory::Step step, bool adjustment = false);
+    bool adjustmentBase(const QString &name, Magick::Image &base);
+    void startNextJob();
+    void finishJob();
+    void setProgress(const Job *job, double fraction);
+    static JobResult runJob(const std::shared_ptr<Job> &job, const Magick::Image &base);
+    static MagickCore::MagickBooleanType monitorJob(const char *tag, MagickCore::MagickOffsetType offset,
+                                                    MagickCore::MagickSizeType extent, void *job);
+    static bool renderFullResolution(const Magick::Image &original, const std::vector<EditHistory::Step> &steps,
+                                     Magick::Image &result, const std::function<void(int done)> &progress = nullptr);
 };
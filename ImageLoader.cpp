@@ -1,9 +1,11 @@
 #include "ImageLoader.h"
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include "ImageProbe.h"
+#include "MetadataCache.h"
 
 #include <QFile>
 #include <QFileInfo>
+#include <QMutexLocker>
+#include <QtConcurrent>
 #include <QTextStream>
 #include <QUrl>
 #include <QByteArray>
@@ -18,6 +20,21 @@ ImageLoader::ImageLoader(QObject *parent) : QObject(parent) {
 }
 
 
+// Pending requests capture this, so they are cancelled and drained before the members go
+ImageLoader::~ImageLoader() {
+    {
+        QMutexLocker locker(&requestMutex);
+        for (const auto& cancelled : std::as_const(inspections))
+            *cancelled = true;
+    }
+    for (QFutureWatcher<bool>* watcher : std::as_const(batches)) {
+        watcher->disconnect(this);
+        watcher->future().cancel();
+    }
+    workers.waitForDone();
+}
+
+
 // Extract and normalize the file extension from the given path
 QString ImageLoader::getFileExtension(const QString &path) {
     QUrl url(path);
@@ -32,10 +49,105 @@ bool ImageLoader::isSupportedExtension(const QString &path) {
 }
 
 
-// Extract metadata for supported image, SVG, or PDF files
+// Extract metadata for supported image, SVG, or PDF files; unchanged files come from MetadataCache.
+// Headers only: the thumbnail is left to inspectFileAsync, so this stays cheap on the GUI thread
 QVariantMap ImageLoader::extractMetadata(const QString &path) {
+    QUrl url(path);
+    QString localPath = url.isLocalFile() ? url.toLocalFile() : path;
+
+    MetadataCache& cache = MetadataCache::instance();
+    QVariantMap meta = cache.lookup(localPath);
+    if (!meta.isEmpty())
+        return meta;
+
     QString ext = getFileExtension(path);
-    return (ext == "svg" || ext == "pdf") ? inspectSvgOrPdf(path) : inspectImage(path);
+    meta = (ext == "svg" || ext == "pdf") ? inspectSvgOrPdf(path) : inspectImage(path);
+    if (meta.isEmpty())
+        return meta;
+
+    return cache.store(localPath, meta);
+}
+
+
+// Validate and extract metadata on the worker pool, then build a missing thumbnail there too;
+// a newer call cancels this one
+int ImageLoader::inspectFileAsync(const QString &path) {
+    if (currentInspection)
+        cancel(currentInspection);
+
+    const int request = ++lastRequest;
+    currentInspection = request;
+
+    auto cancelled = std::make_shared<std::atomic_bool>(false);
+    {
+        QMutexLocker locker(&requestMutex);
+        inspections.insert(request, cancelled);
+    }
+
+    (void) QtConcurrent::run(&workers, [this, request, path, cancelled]() {
+        const bool valid = validateFile(path);
+        const QVariantMap meta = valid && !*cancelled ? extractMetadata(path) : QVariantMap();
+        if (!*cancelled)
+            emit fileInspected(request, path, valid, meta);
+
+        // The preview decodes the whole file, so it follows the metadata instead of holding it up
+        const QString ext = getFileExtension(path);
+        if (!meta.isEmpty() && !meta.contains("thumbnail") && ext != "svg" && ext != "pdf" && !*cancelled) {
+            QUrl url(path);
+            const QString localPath = url.isLocalFile() ? url.toLocalFile() : path;
+            const QImage thumbnail = MetadataCache::thumbnail(localPath, MetadataCache::ThumbnailSize, cancelled.get());
+            if (!thumbnail.isNull() && !*cancelled) {
+                const QVariantMap withThumbnail = MetadataCache::instance().store(localPath, meta, thumbnail);
+                if (!*cancelled)
+                    emit thumbnailReady(request, path, withThumbnail);
+            }
+        }
+
+        QMutexLocker locker(&requestMutex);
+        inspections.remove(request);
+    });
+    return request;
+}
+
+
+// Validate many files in parallel; results keep the order of paths
+int ImageLoader::validateFilesAsync(const QStringList &paths) {
+    const int request = ++lastRequest;
+
+    auto* watcher = new QFutureWatcher<bool>(this);
+    batches.insert(request, watcher);
+
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, request, paths]() {
+        batches.remove(request);
+        watcher->deleteLater();
+        if (watcher->isCanceled())
+            return;
+
+        QStringList validPaths, invalidPaths;
+        const QList<bool> results = watcher->future().results();
+        for (qsizetype i = 0; i < paths.size(); ++i)
+            (i < results.size() && results[i] ? validPaths : invalidPaths) << paths[i];
+
+        emit filesValidated(request, validPaths, invalidPaths);
+    });
+
+    watcher->setFuture(QtConcurrent::mapped(&workers, paths, [this](const QString &path) {
+        return validateFile(path);
+    }));
+    return request;
+}
+
+
+void ImageLoader::cancel(int request) {
+    {
+        QMutexLocker locker(&requestMutex);
+        if (auto it = inspections.find(request); it != inspections.end())
+            **it = true;
+    }
+    if (QFutureWatcher<bool>* watcher = batches.value(request))
+        watcher->future().cancel();
+    if (request == currentInspection)
+        currentInspection = 0;
 }
 
 
@@ -54,28 +166,13 @@ bool ImageLoader::validateFile(const QString &path) {
             return false;
         }
 
-        if (!file.open(QIODevice::ReadOnly)) {
-            qWarning() << "Failed to open file:" << localPath;
+        // Headers only; the pixels are decoded when the job runs
+        const ImageProbe probe = ImageProbe::probe(localPath);
+        if (!probe.isValid())
             return false;
-        }
-
-        QByteArray imageData = file.readAll();
-        qDebug() << "Read" << imageData.size() << "bytes from file.";
-
-        int w = 0, h = 0, c = 0;
-        unsigned char* data = stbi_load_from_memory(
-            reinterpret_cast<const stbi_uc*>(imageData.constData()),
-            imageData.size(), &w, &h, &c, 0);
 
-        if (data) {
-            qDebug() << "Image loaded successfully with dimensions:" << w << "x" << h << "and channels:" << c;
-            stbi_image_free(data);
-            return true;
-        }
-        else {
-            qWarning() << "stbi_load_from_memory failed:" << stbi_failure_reason();
-            return false;
-        }
+        qDebug() << probe.format << "header read with dimensions:" << probe.width << "x" << probe.height << "and channels:" << probe.channels;
+        return true;
     }
     else if (ext == "svg" || ext == "pdf") {
         QFile file(localPath);
@@ -97,49 +194,44 @@ bool ImageLoader::validateFile(const QString &path) {
 }
 
 
-// Extract metadata (dimensions, format hints) from bitmap image files
+// Extract metadata (dimensions, DPI, color profile) from bitmap file headers
 QVariantMap ImageLoader::inspectImage(const QString &path) {
     QVariantMap meta;
     QUrl url(path);
     QString localPath = url.isLocalFile() ? url.toLocalFile() : path;
 
     QFileInfo info(localPath);
-    QFile file(localPath);
-
-    if (!file.open(QIODevice::ReadOnly)) return meta;
-    QByteArray imageData = file.readAll();
-
-    int w = 0, h = 0, c = 0;
-    unsigned char* data = stbi_load_from_memory(
-        reinterpret_cast<const stbi_uc*>(imageData.constData()),
-        imageData.size(), &w, &h, &c, 0);
-
-    if (!data) return meta;
-    stbi_image_free(data);
+    const ImageProbe probe = ImageProbe::probe(localPath);
+    if (!probe.isValid()) return meta;
 
     // Basic metadata
     meta["name"] = info.fileName();
     meta["size"] = info.size();
-    meta["width"] = w;
-    meta["height"] = h;
-    meta["channels"] = c;
+    meta["width"] = probe.width;
+    meta["height"] = probe.height;
+    meta["channels"] = probe.channels;
     meta["extension"] = "." + info.suffix().toLower();
+    meta["format"] = probe.format;
+    meta["bitDepth"] = probe.bitDepth;
+    meta["colorSpace"] = probe.colorSpace;
+
+    if (probe.dpiX > 0 && probe.dpiY > 0) {
+        meta["dpi"] = qRound(probe.dpiX) == qRound(probe.dpiY)
+            ? QString::number(qRound(probe.dpiX))
+            : QString("%1 x %2").arg(qRound(probe.dpiX)).arg(qRound(probe.dpiY));
+    }
 
-    // Attempt to infer color profile from content
-    QString content(imageData);
-    QString profile = "Unknown";
-
-    const QStringList hints = {
-        "sRGB", "Adobe RGB", "CMYK", "Cyan", "Magenta", "Yellow", "Black",
-        "Ic", "Im", "IndexColor", "Indexed", "Palette", "8-color", "16-color",
-        "YCbCr", "LAB", "XYZ", "Gray", "Grayscale", "Mono"
-    };
-
-    for (const QString& hint : hints) {
-        if (content.contains(hint, Qt::CaseInsensitive)) {
-            profile = hint;
-            break;
-        }
+    // Name of the embedded ICC profile, else what the header says about the color space
+    QString profile = ImageProbe::profileDescription(probe.iccProfile);
+    if (profile.isEmpty()) {
+        if (probe.srgb)
+            profile = "sRGB";
+        else if (probe.colorSpace == "Gray")
+            profile = "Grayscale";
+        else if (probe.colorSpace != "RGB")
+            profile = probe.colorSpace;
+        else
+            profile = probe.iccProfile.isEmpty() ? "Unknown" : "Custom ICC";
     }
 
     meta["colorProfile"] = profile;
@@ -1,26 +1,58 @@
 //ImageLoader.h
 #include <QObject>
 #include <QString>
+#include <QStringList>
 #include <QVariantMap>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QMutex>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
 
 
 /****************************************************************************************
     ImageLoader handles validation and metadata extraction for image, SVG, and PDF files.
+
+    The *Async calls run on ImageLoader's own thread pool and answer through signals,
+    so QML never waits on a large file. Inspecting a new file cancels the previous one
+    and its result is never delivered; a batch validates its files in parallel.
+    Thumbnails need a full decode, so extractMetadata reads headers only and the
+    preview is built on the pool after an inspection has delivered its metadata.
 *****************************************************************************************/
 
 class ImageLoader : public QObject {
     Q_OBJECT
 
+signals:
+    void fileInspected(int request, const QString &path, bool valid, const QVariantMap &metadata);
+    void thumbnailReady(int request, const QString &path, const QVariantMap &metadata);   // metadata plus "thumbnail"
+    void filesValidated(int request, const QStringList &validPaths, const QStringList &invalidPaths);
+
 public:
     explicit ImageLoader(QObject *parent = nullptr);
+    ~ImageLoader() override;
 
     Q_INVOKABLE bool validateFile(const QString &path);             // Validate if file is supported and loadable
-    Q_INVOKABLE QVariantMap extractMetadata(const QString &path);   // Extract metadata from supported file
+    Q_INVOKABLE QVariantMap extractMetadata(const QString &path);   // Extract header metadata (cached) from supported file
     Q_INVOKABLE bool isSupportedExtension(const QString &path);     // Check file extension support
 
+    // Asynchronous variants; each returns a request id echoed by its signal
+    Q_INVOKABLE int inspectFileAsync(const QString &path);          // validateFile + extractMetadata -> fileInspected, then thumbnailReady
+    Q_INVOKABLE int validateFilesAsync(const QStringList &paths);   // Parallel validateFile -> filesValidated
+    Q_INVOKABLE void cancel(int request);                           // Drop a pending request; no signal follows
+
 private:
     QStringList supportedExtensions;                                // List of accepted file types
 
+    // Async requests
+    QThreadPool workers;
+    int lastRequest = 0;
+    int currentInspection = 0;                                      // Superseded by the next inspectFileAsync
+    QMutex requestMutex;
+    QHash<int, std::shared_ptr<std::atomic_bool>> inspections;      // Cancel flags of running inspections
+    QHash<int, QFutureWatcher<bool>*> batches;
+
     // Internal helpers
     QString getFileExtension(const QString &path);                  // Extract extension from path
     QVariantMap inspectImage(const QString &path);                  // Metadata for bitmap images
@@ -0,0 +1,79 @@
+// ImagePlane.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+
+/******************************************************************************************
+    PlaneView is a non-owning window onto 8-bit rows: pointer, width, height and stride.
+    ImagePlane owns one aligned allocation for the whole plane; every row starts on a
+    rowAlignment boundary so kernels can use aligned loads, and a band can be handed to
+    writers without per-row copies.
+*******************************************************************************************/
+
+struct PlaneView {
+    uint8_t* data = nullptr;
+    int width = 0;
+    int height = 0;
+    ptrdiff_t stride = 0;
+
+    uint8_t* row(int y) const { return data + y * stride; }
+    PlaneView rows(int y0, int count) const { return { row(y0), width, count, stride }; }
+    bool isContiguous() const { return stride == width; }
+};
+
+
+class ImagePlane {
+public:
+    static constexpr int DefaultAlignment = 64;
+
+    ImagePlane() = default;
+    ImagePlane(int width, int height, int rowAlignment = DefaultAlignment) { reset(width, height, rowAlignment); }
+
+    // Row stride reset() uses for the given width
+    static ptrdiff_t strideFor(int width, int rowAlignment = DefaultAlignment) {
+        return (static_cast<ptrdiff_t>(width) + rowAlignment - 1) / rowAlignment * rowAlignment;
+    }
+
+    // Reallocate only if the current buffer is too small; contents are not preserved
+    void reset(int width, int height, int rowAlignment = DefaultAlignment) {
+        const ptrdiff_t stride = strideFor(width, rowAlignment);
+        const size_t bytes = static_cast<size_t>(stride) * height;
+
+        if (bytes > m_capacity || rowAlignment > m_alignment) {
+            const size_t allocBytes = (bytes + rowAlignment - 1) / rowAlignment * rowAlignment;
+            m_buffer.reset(allocBytes ? static_cast<uint8_t*>(std::aligned_alloc(rowAlignment, allocBytes)) : nullptr);
+            m_capacity = m_buffer ? allocBytes : 0;
+            m_alignment = rowAlignment;
+        }
+
+        m_view = { m_buffer.get(), width, height, stride };
+    }
+
+    void fill(uint8_t value) {
+        if (m_view.data) std::memset(m_view.data, value, static_cast<size_t>(m_view.stride) * m_view.height);
+    }
+
+    uint8_t* row(int y) const { return m_view.row(y); }
+    uint8_t* data() const { return m_view.data; }
+    int width() const { return m_view.width; }
+    int height() const { return m_view.height; }
+    ptrdiff_t stride() const { return m_view.stride; }
+    size_t byteSize() const { return static_cast<size_t>(m_view.stride) * m_view.height; }
+    bool isNull() const { return m_view.data == nullptr; }
+
+    const PlaneView& view() const { return m_view; }
+    operator const PlaneView&() const { return m_view; }
+
+private:
+    struct FreeDeleter { void operator()(uint8_t* p) const { std::free(p); } };
+
+    std::unique_ptr<uint8_t, FreeDeleter> m_buffer;
+    size_t m_capacity = 0;
+    int m_alignment = 0;
+    PlaneView m_view;
+};
@@ -0,0 +1,467 @@
+#include "ImageProbe.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMap>
+#include <QtEndian>
+#include <algorithm>
+
+
+namespace {
+
+constexpr qint64 MaxProfileBytes = 16 * 1024 * 1024;
+constexpr qint64 StbiHeaderBytes = 64 * 1024;
+
+
+// Bytes [offset, offset + length) of an open file or an in-memory block; empty if out of range
+class ByteSource {
+public:
+    explicit ByteSource(QFile* file) : m_file(file) {}
+    explicit ByteSource(const QByteArray& data) : m_data(data) {}
+
+    qint64 size() const { return m_file ? m_file->size() : m_data.size(); }
+
+    QByteArray read(qint64 offset, qint64 length) const {
+        if (offset < 0 || length <= 0 || length > size() - offset)
+            return {};
+        if (!m_file)
+            return m_data.mid(offset, length);
+        if (!m_file->seek(offset))
+            return {};
+        QByteArray bytes = m_file->read(length);
+        return bytes.size() == length ? bytes : QByteArray();
+    }
+
+private:
+    QFile* m_file = nullptr;
+    QByteArray m_data;
+};
+
+
+quint16 be16(const char* p) { return qFromBigEndian<quint16>(p); }
+quint32 be32(const char* p) { return qFromBigEndian<quint32>(p); }
+
+
+// Dots per inch from a density per unit: 1 = inch, 2 = centimetre (JFIF numbering)
+double toDpi(double value, int unit) {
+    return unit == 1 ? value : unit == 2 ? value * 2.54 : 0.0;
+}
+
+
+/*
+    First IFD of a TIFF stream (a file, or the Exif block of a JPEG).
+    Only the tags ImageProbe uses are kept; values that do not fit in the
+    entry are read from their offset.
+*/
+class TiffDirectory {
+public:
+    enum Tag : quint16 {
+        ImageWidth = 256, ImageLength = 257, BitsPerSample = 258, Photometric = 262,
+        SamplesPerPixel = 277, XResolution = 282, YResolution = 283, ResolutionUnit = 296,
+        ICCProfile = 34675
+    };
+
+    bool read(const ByteSource& src) {
+        const QByteArray head = src.read(0, std::min<qint64>(src.size(), 16));
+        if (head.size() < 8)
+            return false;
+        if (head.startsWith("II"))
+            m_little = true;
+        else if (head.startsWith("MM"))
+            m_little = false;
+        else
+            return false;
+
+        // Classic TIFF: 2-byte count, 12-byte entries; BigTIFF: 8-byte count, 20-byte entries
+        const quint64 magic = unpack(head.constData() + 2, 2);
+        const bool big = magic == 43;
+        if (!big && magic != 42)
+            return false;
+        if (big && (head.size() < 16 || unpack(head.constData() + 4, 2) != 8))
+            return false;
+
+        const int countBytes = big ? 8 : 2;
+        const int entryBytes = big ? 20 : 12;
+        const int inlineBytes = big ? 8 : 4;
+        const qint64 ifd = static_cast<qint64>(big ? unpack(head.constData() + 8, 8) : unpack(head.constData() + 4, 4));
+
+        const QByteArray countField = src.read(ifd, countBytes);
+        if (countField.isEmpty())
+            return false;
+        const quint64 count = unpack(countField.constData(), countBytes);
+        if (count == 0 || count > 4096)
+            return false;
+
+        const QByteArray entries = src.read(ifd + countBytes, static_cast<qint64>(count) * entryBytes);
+        if (entries.isEmpty())
+            return false;
+
+        for (quint64 i = 0; i < count; ++i) {
+            const char* entry = entries.constData() + i * entryBytes;
+            const quint16 tag = static_cast<quint16>(unpack(entry, 2));
+            if (!wanted(tag))
+                continue;
+
+            Entry value;
+            value.type = static_cast<quint16>(unpack(entry + 2, 2));
+            value.count = unpack(entry + 4, big ? 8 : 4);
+
+            const int unit = typeBytes(value.type);
+            if (unit == 0 || value.count == 0 || value.count > static_cast<quint64>(MaxProfileBytes / unit))
+                continue;
+
+            const qint64 length = static_cast<qint64>(value.count) * unit;
+            const char* field = entry + 4 + (big ? 8 : 4);
+            value.bytes = length <= inlineBytes
+                ? QByteArray(field, length)
+                : src.read(static_cast<qint64>(unpack(field, inlineBytes)), length);
+            if (!value.bytes.isEmpty())
+                m_entries.insert(tag, value);
+        }
+        return true;
+    }
+
+    // First value of an integer tag
+    quint64 number(Tag tag, quint64 fallback) const {
+        const auto it = m_entries.constFind(tag);
+        if (it == m_entries.constEnd() || it->type == 5)
+            return fallback;
+        return unpack(it->bytes.constData(), typeBytes(it->type));
+    }
+
+    // First value of a RATIONAL tag, 0 if missing
+    double rational(Tag tag) const {
+        const auto it = m_entries.constFind(tag);
+        if (it == m_entries.constEnd() || it->type != 5)
+            return 0.0;
+        const quint64 denominator = unpack(it->bytes.constData() + 4, 4);
+        return denominator ? static_cast<double>(unpack(it->bytes.constData(), 4)) / denominator : 0.0;
+    }
+
+    QByteArray bytes(Tag tag) const { return m_entries.value(tag).bytes; }
+
+    // Resolution in dots per inch from XResolution/YResolution and ResolutionUnit
+    void dpi(double& x, double& y) const {
+        const int unit = static_cast<int>(number(ResolutionUnit, 2)) - 1;     // TIFF: 2 = inch, 3 = cm
+        x = toDpi(rational(XResolution), unit);
+        y = toDpi(rational(YResolution), unit);
+    }
+
+private:
+    struct Entry {
+        quint16 type = 0;
+        quint64 count = 0;
+        QByteArray bytes;
+    };
+
+    bool m_little = true;
+    QHash<quint16, Entry> m_entries;
+
+    static bool wanted(quint16 tag) {
+        switch (tag) {
+        case ImageWidth: case ImageLength: case BitsPerSample: case Photometric: case SamplesPerPixel:
+        case XResolution: case YResolution: case ResolutionUnit: case ICCProfile:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static int typeBytes(quint16 type) {
+        switch (type) {
+        case 1: case 2: case 6: case 7: return 1;       // BYTE, ASCII, SBYTE, UNDEFINED
+        case 3: case 8: return 2;                       // SHORT, SSHORT
+        case 4: case 9: case 11: case 13: return 4;     // LONG, SLONG, FLOAT, IFD
+        case 5: case 10: case 12: case 16: case 17: case 18: return 8;
+        default: return 0;
+        }
+    }
+
+    quint64 unpack(const char* p, int bytes) const {
+        quint64 value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            const quint64 byte = static_cast<uchar>(p[m_little ? bytes - 1 - i : i]);
+            value = (value << 8) | byte;
+        }
+        return value;
+    }
+};
+
+
+bool probeTiff(const ByteSource& src, ImageProbe& probe) {
+    TiffDirectory dir;
+    if (!dir.read(src))
+        return false;
+
+    probe.format = "TIFF";
+    probe.width = static_cast<int>(dir.number(TiffDirectory::ImageWidth, 0));
+    probe.height = static_cast<int>(dir.number(TiffDirectory::ImageLength, 0));
+    probe.bitDepth = static_cast<int>(dir.number(TiffDirectory::BitsPerSample, 1));
+
+    const int samples = static_cast<int>(dir.number(TiffDirectory::SamplesPerPixel, 1));
+    switch (dir.number(TiffDirectory::Photometric, samples >= 3 ? 2 : 1)) {
+    case 0: case 1: probe.colorSpace = "Gray"; break;
+    case 3: probe.colorSpace = "Indexed"; break;
+    case 5: probe.colorSpace = "CMYK"; break;
+    case 8: case 9: case 10: probe.colorSpace = "Lab"; break;
+    default: probe.colorSpace = "RGB"; break;              // RGB, YCbCr
+    }
+    probe.channels = probe.colorSpace == "Indexed" ? 3 : samples;
+
+    dir.dpi(probe.dpiX, probe.dpiY);
+    probe.iccProfile = dir.bytes(TiffDirectory::ICCProfile);
+    return true;
+}
+
+
+// Chunks up to the first IDAT; iCCP is zlib compressed
+bool probePng(const ByteSource& src, ImageProbe& probe) {
+    probe.format = "PNG";
+    bool transparency = false;
+    int colorType = -1;
+
+    for (qint64 pos = 8; ; ) {
+        const QByteArray header = src.read(pos, 8);
+        if (header.isEmpty())
+            break;
+        const qint64 length = be32(header.constData());
+        const QByteArray type = header.mid(4, 4);
+        if (type == "IDAT" || type == "IEND")
+            break;
+
+        if (type == "IHDR" && length >= 13) {
+            const QByteArray d = src.read(pos + 8, 13);
+            if (d.isEmpty())
+                return false;
+            probe.width = static_cast<int>(be32(d.constData()));
+            probe.height = static_cast<int>(be32(d.constData() + 4));
+            probe.bitDepth = static_cast<uchar>(d[8]);
+            colorType = static_cast<uchar>(d[9]);
+        } else if (type == "pHYs" && length >= 9) {
+            const QByteArray d = src.read(pos + 8, 9);
+            if (d.size() == 9 && d[8] == 1) {                 // Pixels per metre
+                probe.dpiX = be32(d.constData()) * 0.0254;
+                probe.dpiY = be32(d.constData() + 4) * 0.0254;
+            }
+        } else if (type == "sRGB") {
+            probe.srgb = true;
+        } else if (type == "tRNS") {
+            transparency = true;
+        } else if (type == "iCCP" && length <= MaxProfileBytes) {
+            const QByteArray d = src.read(pos + 8, length);
+            const qsizetype name = d.indexOf('\0');
+            if (name > 0 && name + 2 < d.size()) {
+                // qUncompress wants a big-endian size hint in front and grows past it if needed
+                QByteArray zlib(4, '\0');
+                qToBigEndian<quint32>(static_cast<quint32>(std::min<qint64>(d.size() * 4, MaxProfileBytes)), zlib.data());
+                zlib += d.mid(name + 2);
+                probe.iccProfile = qUncompress(zlib);
+            }
+        }
+
+        pos += 12 + length;         // Length, type, data, CRC
+    }
+
+    switch (colorType) {
+    case 0: probe.colorSpace = "Gray"; probe.channels = transparency ? 2 : 1; break;
+    case 4: probe.colorSpace = "Gray"; probe.channels = 2; break;
+    case 2: probe.colorSpace = "RGB"; probe.channels = transparency ? 4 : 3; break;
+    case 6: probe.colorSpace = "RGB"; probe.channels = 4; break;
+    case 3: probe.colorSpace = "Indexed"; probe.channels = transparency ? 4 : 3; break;
+    default: return false;
+    }
+    return true;
+}
+
+
+// Markers up to the frame header; every APPn segment precedes it
+bool probeJpeg(const ByteSource& src, ImageProbe& probe) {
+    probe.format = "JPEG";
+    int jfifUnit = 0;
+    double jfifX = 0.0, jfifY = 0.0;
+    int iccCount = 0;
+    QMap<int, QByteArray> iccChunks;
+    bool frame = false;
+
+    for (qint64 pos = 2; !frame; ) {
+        const QByteArray m = src.read(pos, 4);
+        if (m.isEmpty() || static_cast<uchar>(m[0]) != 0xFF)
+            break;
+
+        const uchar marker = static_cast<uchar>(m[1]);
+        if (marker == 0xFF) {                                   // Fill byte
+            ++pos;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+            pos += 2;
+            continue;
+        }
+        if (marker == 0xD9 || marker == 0xDA)                   // EOI, SOS
+            break;
+
+        const qint64 length = be16(m.constData() + 2) - 2;
+        const qint64 data = pos + 4;
+        if (length < 0)
+            break;
+
+        if (marker == 0xE0) {
+            const QByteArray d = src.read(data, std::min<qint64>(length, 12));
+            if (d.size() == 12 && d.startsWith(QByteArray("JFIF\0", 5))) {
+                jfifUnit = static_cast<uchar>(d[7]);
+                jfifX = be16(d.constData() + 8);
+                jfifY = be16(d.constData() + 10);
+            }
+        } else if (marker == 0xE1 && length > 6) {
+            if (src.read(data, 6) == QByteArray("Exif\0\0", 6)) {
+                TiffDirectory exif;
+                if (exif.read(ByteSource(src.read(data + 6, length - 6))) && probe.dpiX == 0.0)
+                    exif.dpi(probe.dpiX, probe.dpiY);
+            }
+        } else if (marker == 0xE2 && length > 14) {
+            const QByteArray d = src.read(data, 14);
+            if (d.startsWith(QByteArray("ICC_PROFILE\0", 12))) {
+                iccCount = static_cast<uchar>(d[13]);
+                iccChunks.insert(static_cast<uchar>(d[12]), src.read(data + 14, length - 14));
+            }
+        } else if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            const QByteArray d = src.read(data, 6);
+            if (d.isEmpty())
+                return false;
+            probe.bitDepth = static_cast<uchar>(d[0]);
+            probe.height = be16(d.constData() + 1);
+            probe.width = be16(d.constData() + 3);
+            probe.channels = static_cast<uchar>(d[5]);
+            frame = true;
+        }
+
+        pos = data + length;
+    }
+
+    if (!frame)
+        return false;
+
+    // YCbCr and YCCK are how RGB and CMYK are coded, not color spaces of their own
+    probe.colorSpace = probe.channels == 1 ? "Gray" : probe.channels == 4 ? "CMYK" : "RGB";
+
+    // JFIF density wins over Exif when it names a unit
+    if (jfifUnit == 1 || jfifUnit == 2) {
+        probe.dpiX = toDpi(jfifX, jfifUnit);
+        probe.dpiY = toDpi(jfifY, jfifUnit);
+    }
+
+    // Profile chunks are numbered from 1; use them only if none is missing
+    if (iccCount > 0 && iccChunks.size() == iccCount && iccChunks.firstKey() == 1 && iccChunks.lastKey() == iccCount) {
+        for (const QByteArray& chunk : iccChunks)
+            probe.iccProfile += chunk;
+    }
+    return true;
+}
+
+
+// Anything stb_image knows, from the first 64 KB
+bool probeStbi(const ByteSource& src, ImageProbe& probe, const QString& localPath) {
+    const QByteArray head = src.read(0, std::min(src.size(), StbiHeaderBytes));
+    const auto* bytes = reinterpret_cast<const stbi_uc*>(head.constData());
+    const int length = static_cast<int>(head.size());
+
+    int w = 0, h = 0, c = 0;
+    if (!stbi_info_from_memory(bytes, length, &w, &h, &c)) {
+        qWarning() << "stbi_info_from_memory failed:" << stbi_failure_reason();
+        return false;
+    }
+
+    probe.format = head.startsWith("BM") ? QString("BMP") : QFileInfo(localPath).suffix().toUpper();
+    probe.width = w;
+    probe.height = h;
+    probe.channels = c;
+    probe.bitDepth = stbi_is_16_bit_from_memory(bytes, length) ? 16 : 8;
+    probe.colorSpace = c <= 2 ? "Gray" : "RGB";
+
+    // BITMAPINFOHEADER and later carry pixels per metre
+    if (head.startsWith("BM") && head.size() >= 46 && qFromLittleEndian<quint32>(head.constData() + 14) >= 40) {
+        probe.dpiX = qFromLittleEndian<qint32>(head.constData() + 38) * 0.0254;
+        probe.dpiY = qFromLittleEndian<qint32>(head.constData() + 42) * 0.0254;
+    }
+    return true;
+}
+
+}
+
+
+ImageProbe ImageProbe::probe(const QString& localPath) {
+    ImageProbe result;
+
+    QFile file(localPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot open image:" << localPath;
+        return result;
+    }
+
+    const ByteSource src(&file);
+    const QByteArray magic = src.read(0, std::min<qint64>(src.size(), 8));
+
+    bool ok = false;
+    if (magic.startsWith("\x89PNG\r\n\x1a\n"))
+        ok = probePng(src, result);
+    else if (magic.startsWith("\xFF\xD8\xFF"))
+        ok = probeJpeg(src, result);
+    else if (magic.startsWith("II") || magic.startsWith("MM"))
+        ok = probeTiff(src, result);
+    else
+        ok = probeStbi(src, result, localPath);
+
+    if (!ok || !result.isValid()) {
+        qWarning() << "Cannot read image header:" << localPath;
+        return ImageProbe();
+    }
+    return result;
+}
+
+
+QString ImageProbe::profileDescription(const QByteArray& icc) {
+    const qint64 size = icc.size();
+    if (size < 132)
+        return {};
+
+    const char* p = icc.constData();
+    const qint64 tags = be32(p + 128);
+    if (tags > (size - 132) / 12)
+        return {};
+
+    for (qint64 i = 0; i < tags; ++i) {
+        const char* tag = p + 132 + i * 12;
+        if (QByteArray(tag, 4) != "desc")
+            continue;
+
+        const qint64 offset = be32(tag + 4);
+        const qint64 length = be32(tag + 8);
+        if (offset + length > size || length < 12)
+            return {};
+        const char* element = p + offset;
+
+        // v2 textDescriptionType: ASCII count (with NUL) then the text
+        if (QByteArray(element, 4) == "desc") {
+            const qint64 count = std::min<qint64>(be32(element + 8), length - 12);
+            return QString::fromLatin1(element + 12, qstrnlen(element + 12, static_cast<uint>(count))).trimmed();
+        }
+
+        // v4 multiLocalizedUnicodeType: the first record's UTF-16BE string
+        if (QByteArray(element, 4) == "mluc" && length >= 28 && be32(element + 8) > 0) {
+            const qint64 bytes = be32(element + 20);
+            const qint64 start = be32(element + 24);
+            if (start + bytes > length)
+                return {};
+            QString text;
+            for (qint64 c = 0; c + 1 < bytes; c += 2)
+                text += QChar(be16(element + start + c));
+            return text.trimmed();
+        }
+        return {};
+    }
+    return {};
+}
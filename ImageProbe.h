@@ -0,0 +1,39 @@
+// ImageProbe.h
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+
+/*******************************************************************************************
+    ImageProbe reads what ImageLoader shows about a bitmap without decoding any pixels.
+
+        PNG     IHDR, pHYs, sRGB and iCCP chunks up to the first IDAT
+        JPEG    JFIF/Exif density, ICC_PROFILE markers and the SOF header
+        TIFF    first IFD of classic or BigTIFF files, including the ICC profile tag
+        other   stbi_info_from_memory on the first 64 KB
+
+    Markers and chunks that do not matter are skipped with a seek, so only headers and
+    the embedded profile are read however large the file is.
+********************************************************************************************/
+
+struct ImageProbe {
+    QString format;                 // "PNG", "JPEG", "TIFF", "BMP", ...
+    int width = 0;
+    int height = 0;
+    int channels = 0;               // Samples per pixel as stored, palette counted as RGB
+    int bitDepth = 0;               // Bits per sample
+    QString colorSpace;             // "RGB", "Gray", "CMYK", "Indexed", "Lab"
+    double dpiX = 0.0;              // 0 when the file does not say
+    double dpiY = 0.0;
+    bool srgb = false;              // PNG sRGB chunk
+    QByteArray iccProfile;          // Embedded profile, empty if none
+
+    bool isValid() const { return width > 0 && height > 0; }
+
+    // Probe a local file; an invalid result (with a warning) if the header cannot be read
+    static ImageProbe probe(const QString& localPath);
+
+    // 'desc' text of an ICC profile (v2 desc or v4 mluc), empty if it has none
+    static QString profileDescription(const QByteArray& icc);
+};
@@ -0,0 +1,79 @@
+#include "MaskCache.h"
+#include <QDebug>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <Magick++.h>
+
+
+void MaskTile::copyRow(int y, int x0, uint8_t* dst, int count) const {
+    const uint8_t* tileRow = data + static_cast<size_t>(((y - offsetY) % height + height) % height) * width;
+
+    // Whole runs of the tile row instead of one modulo per pixel
+    int sx = ((x0 - offsetX) % width + width) % width;
+    while (count > 0) {
+        const int run = std::min(count, width - sx);
+        std::memcpy(dst, tileRow + sx, run);
+        dst += run;
+        count -= run;
+        sx = 0;
+    }
+}
+
+
+bool MaskCache::channelTiles(int size, std::array<MaskTile, 4>& tiles) {
+    static QMutex mutex;
+    static std::map<int, std::array<Tile, 4>> cache;    // Nodes never move, so views stay valid
+
+    QMutexLocker locker(&mutex);
+
+    auto it = cache.find(size);
+    if (it == cache.end()) {
+        static const std::array<QString, 4> channelNames = { "c", "m", "y", "k" };
+        std::array<Tile, 4> loaded;
+
+        for (int ch = 0; ch < 4; ++ch) {
+            const QString path = QString(":/assets/blue_noise_mask_%1/mask_%2.tiff").arg(size).arg(channelNames[ch]);
+            if (!loadTile(path, loaded[ch]))
+                return false;
+        }
+
+        it = cache.emplace(size, std::move(loaded)).first;
+    }
+
+    for (int ch = 0; ch < 4; ++ch) {
+        const Tile& tile = it->second[ch];
+        tiles[ch] = { tile.data.data(), tile.width, tile.height, RollOffsets[ch], RollOffsets[ch] };
+    }
+    return true;
+}
+
+
+// Decode a mask resource to 8-bit grayscale
+bool MaskCache::loadTile(const QString& resourcePath, Tile& tile) {
+    QFile file(resourcePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Mask resource missing:" << resourcePath;
+        return false;
+    }
+
+    const QByteArray bytes = file.readAll();
+
+    try {
+        Magick::Image maskImage(Magick::Blob(bytes.constData(), static_cast<size_t>(bytes.size())));
+        maskImage.type(Magick::GrayscaleType);
+
+        tile.width = static_cast<int>(maskImage.columns());
+        tile.height = static_cast<int>(maskImage.rows());
+        tile.data.resize(static_cast<size_t>(tile.width) * tile.height);
+        maskImage.write(0, 0, tile.width, tile.height, "I", Magick::CharPixel, tile.data.data());
+    } catch (const Magick::Exception& e) {
+        qWarning() << "Failed to load mask tile:" << resourcePath << e.what();
+        return false;
+    }
+
+    return tile.width > 0 && tile.height > 0;
+}
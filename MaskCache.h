@@ -0,0 +1,45 @@
+// MaskCache.h
+#pragma once
+
+#include <QString>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+
+// Blue noise threshold tile, looked up with modular indexing after a roll by (offsetX, offsetY)
+struct MaskTile {
+    const uint8_t* data = nullptr;
+    int width = 0;
+    int height = 0;
+    int offsetX = 0;
+    int offsetY = 0;
+
+    // Mask values for pixels [x0, x0 + count) of page row y, as `-roll +X+Y` over a tiled mask
+    void copyRow(int y, int x0, uint8_t* dst, int count) const;
+};
+
+
+/*******************************************************************************************
+    MaskCache holds the bundled blue noise masks (256 and 512, one per C, M, Y, K) as raw
+    8-bit tiles. Each size is decoded from the qrc assets the first time it is asked for
+    and kept for the life of the process; callers get rolled MaskTile views onto it, so no
+    page-sized mask is ever built.
+********************************************************************************************/
+
+class MaskCache {
+public:
+    static constexpr std::array<int, 4> RollOffsets = { 0, 64, 128, 192 };   // Per channel, x and y
+
+    // C, M, Y, K tiles of the given size (256 or 512) with the per-channel roll applied
+    static bool channelTiles(int size, std::array<MaskTile, 4>& tiles);
+
+private:
+    struct Tile {
+        std::vector<uint8_t> data;
+        int width = 0;
+        int height = 0;
+    };
+
+    static bool loadTile(const QString& resourcePath, Tile& tile);
+};
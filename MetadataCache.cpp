@@ -0,0 +1,181 @@
+#include "MetadataCache.h"
+#include "ScanlineReader.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUrl>
+#include <algorithm>
+#include <vector>
+
+
+namespace {
+
+constexpr quint32 FileMagic = 0x52494D31;       // "RIM1"
+constexpr int ThumbnailBandRows = 64;
+
+QString cachePath(const QString& absolutePath, const char* suffix) {
+    const QByteArray key = QCryptographicHash::hash(absolutePath.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/imagemeta/"
+           + QString::fromLatin1(key) + suffix;
+}
+
+}
+
+
+MetadataCache& MetadataCache::instance() {
+    static MetadataCache cache;
+    return cache;
+}
+
+
+QVariantMap MetadataCache::lookup(const QString& localPath) {
+    const QFileInfo info(localPath);
+    if (!info.isFile())
+        return QVariantMap();
+
+    const QString path = info.absoluteFilePath();
+    const qint64 size = info.size();
+    const QDateTime modified = info.lastModified();
+
+    QMutexLocker locker(&m_mutex);
+
+    auto it = m_entries.constFind(path);
+    if (it != m_entries.constEnd() && it->size == size && it->modified == modified)
+        return it->meta;
+
+    // Not seen this run; the disk copy is good if it describes the same file
+    Entry entry;
+    if (!load(path, entry) || entry.size != size || entry.modified != modified)
+        return QVariantMap();
+
+    m_entries.insert(path, entry);
+    return entry.meta;
+}
+
+
+QVariantMap MetadataCache::store(const QString& localPath, QVariantMap meta, const QImage& thumbnail) {
+    const QFileInfo info(localPath);
+    if (!info.isFile())
+        return meta;
+
+    const QString path = info.absoluteFilePath();
+    QDir().mkpath(QFileInfo(cachePath(path, "")).absolutePath());
+
+    if (!thumbnail.isNull()) {
+        const QString thumbnailPath = cachePath(path, ".png");
+        QSaveFile file(thumbnailPath);
+        if (file.open(QIODevice::WriteOnly) && thumbnail.save(&file, "PNG") && file.commit())
+            meta["thumbnail"] = QUrl::fromLocalFile(thumbnailPath).toString();
+    }
+
+    Entry entry { info.size(), info.lastModified(), meta };
+    if (!save(path, entry))
+        qWarning() << "Could not write metadata cache for:" << path;
+
+    QMutexLocker locker(&m_mutex);
+    m_entries.insert(path, entry);
+    return meta;
+}
+
+
+void MetadataCache::clear() {
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+}
+
+
+/*
+    Rows stream through ScanlineReader and are summed into thumbnail cells,
+    so even a banner larger than memory previews with a few bands resident.
+*/
+QImage MetadataCache::thumbnail(const QString& localPath, int maxSide, const std::atomic_bool* cancelled) {
+    std::unique_ptr<ScanlineReader> reader = ScanlineReader::open(localPath);
+    if (!reader)
+        return QImage();
+
+    const int width = reader->width();
+    const int height = reader->height();
+    const double scale = std::min(1.0, static_cast<double>(maxSide) / std::max(width, height));
+    const int thumbWidth = std::max(1, static_cast<int>(width * scale + 0.5));
+    const int thumbHeight = std::max(1, static_cast<int>(height * scale + 0.5));
+
+    // Thumbnail column of every source column
+    std::vector<int> column(width);
+    for (int x = 0; x < width; ++x)
+        column[x] = static_cast<int>(static_cast<qint64>(x) * thumbWidth / width);
+
+    std::vector<quint64> sums(static_cast<size_t>(thumbWidth) * thumbHeight * 3, 0);
+    std::vector<quint64> counts(static_cast<size_t>(thumbWidth) * thumbHeight, 0);
+    std::vector<uchar> band(static_cast<size_t>(width) * ThumbnailBandRows * 3);
+
+    for (int y0 = 0; y0 < height; y0 += ThumbnailBandRows) {
+        const int rows = std::min(ThumbnailBandRows, height - y0);
+        if ((cancelled && *cancelled) || !reader->readRows(band.data(), rows))
+            return QImage();
+
+        for (int r = 0; r < rows; ++r) {
+            const size_t cellRow = static_cast<size_t>(static_cast<qint64>(y0 + r) * thumbHeight / height) * thumbWidth;
+            const uchar* src = band.data() + static_cast<size_t>(r) * width * 3;
+            for (int x = 0; x < width; ++x, src += 3) {
+                const size_t cell = cellRow + column[x];
+                sums[cell * 3] += src[0];
+                sums[cell * 3 + 1] += src[1];
+                sums[cell * 3 + 2] += src[2];
+                ++counts[cell];
+            }
+        }
+    }
+
+    QImage image(thumbWidth, thumbHeight, QImage::Format_RGB888);
+    for (int y = 0; y < thumbHeight; ++y) {
+        uchar* dst = image.scanLine(y);
+        for (int x = 0; x < thumbWidth; ++x) {
+            const size_t cell = static_cast<size_t>(y) * thumbWidth + x;
+            const quint64 n = std::max<quint64>(counts[cell], 1);
+            for (int c = 0; c < 3; ++c)
+                dst[x * 3 + c] = static_cast<uchar>((sums[cell * 3 + c] + n / 2) / n);
+        }
+    }
+    return image;
+}
+
+
+bool MetadataCache::load(const QString& absolutePath, Entry& entry) const {
+    QFile file(cachePath(absolutePath, ".meta"));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    QString path;
+    in >> magic >> path >> entry.size >> entry.modified >> entry.meta;
+    if (in.status() != QDataStream::Ok || magic != FileMagic || path != absolutePath)
+        return false;
+
+    // The thumbnail may have been cleaned out of the cache on its own
+    const QString thumbnail = entry.meta.value("thumbnail").toString();
+    if (!thumbnail.isEmpty() && !QFile::exists(QUrl(thumbnail).toLocalFile()))
+        entry.meta.remove("thumbnail");
+    return true;
+}
+
+
+bool MetadataCache::save(const QString& absolutePath, const Entry& entry) const {
+    // Written to a temporary and renamed, so a crash never leaves half an entry behind
+    QSaveFile file(cachePath(absolutePath, ".meta"));
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << FileMagic << absolutePath << entry.size << entry.modified << entry.meta;
+    return out.status() == QDataStream::Ok && file.commit();
+}
@@ -0,0 +1,54 @@
+// MetadataCache.h
+#pragma once
+
+#include <QDateTime>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+#include <QVariantMap>
+#include <atomic>
+
+
+/*******************************************************************************************
+    MetadataCache remembers what ImageLoader found out about a file, plus a small preview
+    thumbnail, in memory and in the user cache directory. Entries are keyed by absolute
+    path and only trusted while the file's size and mtime are unchanged, so reopening a
+    job list costs one stat per file.
+
+        <CacheLocation>/imagemeta/<sha1 of path>.meta     metadata map
+        <CacheLocation>/imagemeta/<sha1 of path>.png      thumbnail, meta["thumbnail"]
+********************************************************************************************/
+
+class MetadataCache {
+public:
+    static constexpr int ThumbnailSize = 256;
+
+    static MetadataCache& instance();
+
+    // Stored metadata if the file has not changed since, otherwise empty
+    QVariantMap lookup(const QString& localPath);
+
+    // Remember meta for the file as it is now; a non-null thumbnail is saved and linked
+    QVariantMap store(const QString& localPath, QVariantMap meta, const QImage& thumbnail = QImage());
+
+    // Box-filtered RGB preview no larger than maxSide, decoded a band at a time;
+    // null if the file cannot be read or cancelled is set while decoding
+    static QImage thumbnail(const QString& localPath, int maxSide = ThumbnailSize,
+                            const std::atomic_bool* cancelled = nullptr);
+
+    void clear();                   // In-memory entries only
+
+private:
+    struct Entry {
+        qint64 size = -1;
+        QDateTime modified;
+        QVariantMap meta;
+    };
+
+    QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+
+    bool load(const QString& absolutePath, Entry& entry) const;
+    bool save(const QString& absolutePath, const Entry& entry) const;
+};
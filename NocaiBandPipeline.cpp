@@ -0,0 +1,229 @@
+#include "NocaiBandPipeline.h"
+#include "NocaiKernels.h"
+#include "ParallelFor.h"
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+
+// Nocai interleaves each output row as Y, M, C, K
+static const std::array<int, 4> nocaiOrder = { 2, 1, 0, 3 };
+
+
+// Open the PRN file and write its header
+bool NocaiBandPipeline::begin(const QString& localPath, int width, int height, int xdpi, int ydpi,
+                              const std::array<MaskTile, 4>& masks, int bandRows) {
+    m_width = width;
+    m_height = height;
+    m_masks = masks;
+    m_bandRows = bandRows;
+    m_emittedRows = 0;
+    m_kernels = &NocaiKernels::active();
+
+    // 4 pixels per byte, each line padded to a multiple of 4 bytes
+    m_bytesPerLine = ((width + 3) / 4 + 3) / 4 * 4;
+
+    // A band plus the promotion halo: one finished row above, two pending rows below
+    for (ChannelState& state : m_channels) {
+        state.dots.reset(width, bandRows + 3);
+        state.promoted.reset(width, bandRows + 3);
+        state.fedRows = 0;
+    }
+
+    const uint32_t header[PRNWriter::HeaderFields] = {
+        0x00005555,
+        static_cast<uint32_t>(xdpi),
+        static_cast<uint32_t>(ydpi),
+        static_cast<uint32_t>(m_bytesPerLine),
+        static_cast<uint32_t>(height),
+        static_cast<uint32_t>(width),
+        0, 4, 1, 1, 0, 0
+    };
+
+    return m_writer.open(localPath, header, 4 * m_bytesPerLine, height, bandRows + 3);
+}
+
+
+// Threshold the next rows of every channel (u >= v ? dot : none) and classify them.
+// Channels and row chunks within a channel are independent and run on the pool.
+void NocaiBandPipeline::screenBands(const std::array<PlaneView, 4>& ink) {
+    const int rows = ink[0].height;
+    // The ring only holds one band plus the promotion halo
+    Q_ASSERT_X(rows <= m_bandRows && m_channels[0].fedRows - m_emittedRows <= 2,
+               "NocaiBandPipeline", "more than bandRows rows fed without commitBand()");
+
+    parallelFor(m_pool, 4 * rows, [&](int begin, int end) {
+        thread_local ImagePlane scratch;
+        scratch.reset(m_width, 2);
+        uint8_t* mask = scratch.row(0);
+        uint8_t* dithered = scratch.row(1);
+
+        for (int task = begin; task < end; ++task) {
+            const int ch = task / rows;
+            const int r = task % rows;
+            const ChannelState& state = m_channels[ch];
+            const int y = state.fedRows + r;
+
+            m_masks[ch].copyRow(y, 0, mask, m_width);
+            m_kernels->threshold(ink[ch].row(r), mask, dithered, m_width);
+            m_kernels->classify(dithered, mask, state.at(y), m_width);
+        }
+    }, MinRowsPerTask);
+
+    for (ChannelState& state : m_channels)
+        state.fedRows += rows;
+}
+
+
+// Classify rows that were already dithered elsewhere against the same mask tiles
+void NocaiBandPipeline::classifyBands(const std::array<PlaneView, 4>& dithered) {
+    const int rows = dithered[0].height;
+    Q_ASSERT_X(rows <= m_bandRows && m_channels[0].fedRows - m_emittedRows <= 2,
+               "NocaiBandPipeline", "more than bandRows rows fed without commitBand()");
+
+    parallelFor(m_pool, 4 * rows, [&](int begin, int end) {
+        thread_local ImagePlane scratch;
+        scratch.reset(m_width, 1);
+        uint8_t* mask = scratch.row(0);
+
+        for (int task = begin; task < end; ++task) {
+            const int ch = task / rows;
+            const int r = task % rows;
+            const ChannelState& state = m_channels[ch];
+            const int y = state.fedRows + r;
+
+            m_masks[ch].copyRow(y, 0, mask, m_width);
+            m_kernels->classify(dithered[ch].row(r), mask, state.at(y), m_width);
+        }
+    }, MinRowsPerTask);
+
+    for (ChannelState& state : m_channels)
+        state.fedRows += rows;
+}
+
+
+// Promote, pack and write every row whose 4x4 window is complete
+bool NocaiBandPipeline::commitBand() {
+    const int fed = m_channels[0].fedRows;
+
+    // Row y is final once rows up to y + 2 are classified
+    const int finalRows = (fed >= m_height) ? m_height : std::max(0, fed - 2);
+    const int count = finalRows - m_emittedRows;
+    if (count <= 0) return true;
+
+    // Each PRN line holds the four packed channel lines back to back
+    const PlaneView band = m_writer.rows(m_emittedRows, count);
+
+    // Promotion is serial top to bottom, so each channel is cut into segments promoted
+    // speculatively against the unpromoted row above, then patched in order below
+    const int workers = m_pool ? m_pool->maxThreadCount() : 1;
+    const int segments = std::max(1, std::min(workers, count / MinRowsPerTask));
+    auto segmentStart = [&](int s) { return m_emittedRows + static_cast<int>(static_cast<long long>(count) * s / segments); };
+
+    parallelFor(m_pool, 4 * segments, [&](int begin, int end) {
+        for (int task = begin; task < end; ++task) {
+            const ChannelState& state = m_channels[task / segments];
+            const int s = task % segments;
+            const int y0 = segmentStart(s);
+
+            for (int y = y0; y < segmentStart(s + 1); ++y)
+                apply4x4Promotion(state, y, y == y0 && s > 0);
+        }
+    });
+
+    parallelFor(m_pool, 4, [&](int begin, int end) {
+        for (int ch = begin; ch < end; ++ch)
+            for (int s = 1; s < segments; ++s)
+                repairSegment(m_channels[ch], segmentStart(s), segmentStart(s + 1));
+    });
+
+    // Packing is independent per row and channel, and lands at the row's final offset
+    parallelFor(m_pool, 4 * count, [&](int begin, int end) {
+        for (int task = begin; task < end; ++task) {
+            const int i = task / count;
+            const int r = task % count;
+            m_kernels->pack2bpp(m_channels[nocaiOrder[i]].promotedAt(m_emittedRows + r), band.row(r) + i * m_bytesPerLine, m_width);
+        }
+    }, MinRowsPerTask);
+
+    // The ring keeps the last finished row as the halo for the next promotion
+    const bool written = m_writer.commit(m_emittedRows, count);
+    m_emittedRows = finalRows;
+    return written;
+}
+
+
+// Flush the trailing rows and close the file
+bool NocaiBandPipeline::finish() {
+    if (!commitBand()) return false;
+
+    if (m_emittedRows != m_height) {
+        qWarning() << "PRN incomplete:" << m_emittedRows << "of" << m_height << "rows written";
+        return false;
+    }
+
+    return m_writer.close();
+}
+
+
+// Promote a dot to large when 12 of the 16 pixels in its 4x4 window carry ink, writing
+// row y of the promoted ring. The scan runs left to right as if in place, so pixels left
+// of x are already promoted. Row y - 1 is the promoted one unless `speculative` asks for
+// the classified row (see repairSegment). The window count is kept as a running sum of
+// per-column counts: O(1) per pixel instead of 16 reads.
+void NocaiBandPipeline::apply4x4Promotion(const ChannelState& state, int y, bool speculative) const {
+    uint8_t* row = state.promotedAt(y);
+    std::memcpy(row, state.at(y), m_width);
+    if (y < 1 || y >= m_height - 2 || m_width < 4) return;
+
+    const uint8_t* above = speculative ? state.at(y - 1) : state.promotedAt(y - 1);
+    const uint8_t* current = state.at(y);
+    const uint8_t* below1 = state.at(y + 1);
+    const uint8_t* below2 = state.at(y + 2);
+
+    // Dots present in rows y-1..y+2 of each column
+    thread_local ImagePlane counts;
+    counts.reset(m_width, 1);
+    uint8_t* columns = counts.data();
+    for (int x = 0; x < m_width; ++x)
+        columns[x] = (above[x] != 0) + (current[x] != 0) + (below1[x] != 0) + (below2[x] != 0);
+
+    int count = columns[0] + columns[1] + columns[2] + columns[3];
+
+    for (int x = 1; x < m_width - 2; ++x) {
+        if (row[x] != 3 && count >= 12) {
+            // An empty pixel gaining a dot is still inside the window of x + 1
+            if (row[x] == 0) {
+                ++columns[x];
+                ++count;
+            }
+            row[x] = 3;
+        }
+
+        if (x + 3 < m_width)
+            count += columns[x + 3] - columns[x - 1];
+    }
+}
+
+
+// A segment promoted against the unpromoted row above can only have missed promotions:
+// promotion adds dots, and more dots above never remove one below. Redo rows from the
+// top of the segment with the real row above until a row gains no new dot; later rows
+// only see this one through which pixels carry a dot, so they are already exact.
+void NocaiBandPipeline::repairSegment(const ChannelState& state, int y0, int y1) const {
+    thread_local ImagePlane previous;
+    previous.reset(m_width, 1);
+
+    for (int y = y0; y < y1; ++y) {
+        std::memcpy(previous.data(), state.promotedAt(y), m_width);
+        apply4x4Promotion(state, y, false);
+
+        const uint8_t* before = previous.data();
+        const uint8_t* after = state.promotedAt(y);
+        bool gained = false;
+        for (int x = 0; x < m_width && !gained; ++x)
+            gained = (before[x] == 0 && after[x] != 0);
+
+        if (!gained) return;
+    }
+}
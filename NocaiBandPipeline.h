@@ -0,0 +1,71 @@
+// NocaiBandPipeline.h
+#pragma once
+
+#include "ImagePlane.h"
+#include "MaskCache.h"
+#include "PRNWriter.h"
+#include <QString>
+#include <array>
+#include <cstdint>
+
+class QThreadPool;
+namespace NocaiKernels { struct Table; }
+
+
+/********************************************************************************************
+    NocaiBandPipeline screens, classifies, promotes, packs and writes a Nocai 2BPP PRN a band
+    of rows at a time. Each channel only keeps the band being fed plus the rows needed by the
+    4x4 promotion window (one finished row above, two classified rows below), so peak memory
+    depends on page width rather than page area. Dot rows live in ring ImagePlanes per
+    channel and packed rows go straight into the mapped output file (see PRNWriter).
+
+    Work inside a band is split across channels and row chunks on an optional thread pool.
+    Promotion, which is serial top to bottom, runs speculatively per row segment and is
+    then repaired in order, so the output matches a single-threaded run exactly.
+
+    Usage per page:
+        begin() -> { screenBands() or classifyBands() -> commitBand() }* -> finish()
+    with at most bandRows rows per screenBands()/classifyBands() call.
+*********************************************************************************************/
+
+class NocaiBandPipeline {
+public:
+    static constexpr int DefaultBandRows = 256;
+    static constexpr int MinRowsPerTask = 8;
+
+    void setThreadPool(QThreadPool* pool) { m_pool = pool; }                             // nullptr = run on the caller
+
+    bool begin(const QString& localPath, int width, int height, int xdpi, int ydpi,
+               const std::array<MaskTile, 4>& masks, int bandRows = DefaultBandRows); // Open output and write header
+    void screenBands(const std::array<PlaneView, 4>& ink);                            // Threshold ink rows against the mask tiles
+    void classifyBands(const std::array<PlaneView, 4>& dithered);                     // Rows already dithered against the same tiles
+    bool commitBand();                                                               // Promote, pack and write finished rows
+    bool finish();                                                                   // Flush remaining rows and close
+
+    int bytesPerLine() const { return m_bytesPerLine; }
+
+private:
+    struct ChannelState {
+        ImagePlane dots;        // Ring of classified dot rows, row y lives at y % dots.height()
+        ImagePlane promoted;    // Same rows after 4x4 promotion
+        int fedRows = 0;
+
+        uint8_t* at(int y) const { return dots.row(y % dots.height()); }
+        uint8_t* promotedAt(int y) const { return promoted.row(y % promoted.height()); }
+    };
+
+    int m_width = 0;
+    int m_height = 0;
+    int m_bytesPerLine = 0;
+    int m_bandRows = 0;
+    int m_emittedRows = 0;
+
+    std::array<MaskTile, 4> m_masks;
+    std::array<ChannelState, 4> m_channels;
+    PRNWriter m_writer;         // Packed rows, interleaved Y,M,C,K, written in place at their file offsets
+    const NocaiKernels::Table* m_kernels = nullptr;
+    QThreadPool* m_pool = nullptr;
+
+    void apply4x4Promotion(const ChannelState& state, int y, bool speculative) const;
+    void repairSegment(const ChannelState& state, int y0, int y1) const;
+};
@@ -0,0 +1,213 @@
+#include "NocaiKernels.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NOCAI_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+
+namespace NocaiKernels {
+
+// === Scalar ===
+
+static void thresholdScalar(const uint8_t* ink, const uint8_t* mask, uint8_t* dithered, int width) {
+    for (int x = 0; x < width; ++x)
+        dithered[x] = (ink[x] >= mask[x]) ? 255 : 0;
+}
+
+static void classifyScalar(const uint8_t* dithered, const uint8_t* mask, uint8_t* dots, int width) {
+    for (int x = 0; x < width; ++x) {
+        const uint8_t t = mask[x];
+        const uint8_t level = 3 - (t >= 128) - (t >= 192);
+        dots[x] = (dithered[x] >= 128) ? level : 0;
+    }
+}
+
+static void pack2bppScalar(const uint8_t* dots, uint8_t* line, int width) {
+    int x = 0;
+    for (; x + 4 <= width; x += 4)
+        *line++ = static_cast<uint8_t>(((dots[x] & 3) << 6) | ((dots[x + 1] & 3) << 4) | ((dots[x + 2] & 3) << 2) | (dots[x + 3] & 3));
+
+    if (x < width) {
+        uint8_t byte = 0;
+        for (int shift = 6; x < width; ++x, shift -= 2)
+            byte |= static_cast<uint8_t>((dots[x] & 3) << shift);
+        *line = byte;
+    }
+}
+
+
+#ifdef NOCAI_KERNELS_X86
+
+// === SSE2 ===
+
+static void thresholdSSE2(const uint8_t* ink, const uint8_t* mask, uint8_t* dithered, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i u = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ink + x));
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + x));
+        // u >= v  <=>  max(u, v) == u
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dithered + x), _mm_cmpeq_epi8(_mm_max_epu8(u, v), u));
+    }
+    thresholdScalar(ink + x, mask + x, dithered + x, width - x);
+}
+
+static void classifySSE2(const uint8_t* dithered, const uint8_t* mask, uint8_t* dots, int width) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i three = _mm_set1_epi8(3);
+    const __m128i t192 = _mm_set1_epi8(static_cast<char>(192));
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dithered + x));
+        const __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + x));
+        const __m128i hasDot = _mm_cmplt_epi8(d, zero);                    // d >= 128
+        const __m128i ge128 = _mm_cmplt_epi8(t, zero);                     // t >= 128, as -1
+        const __m128i ge192 = _mm_cmpeq_epi8(_mm_max_epu8(t, t192), t);    // t >= 192, as -1
+        const __m128i level = _mm_add_epi8(three, _mm_add_epi8(ge128, ge192));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dots + x), _mm_and_si128(level, hasDot));
+    }
+    classifyScalar(dithered + x, mask + x, dots + x, width - x);
+}
+
+// Fold 16 dot bytes (4 per 32-bit lane, first pixel lowest) into one packed byte per lane
+static inline __m128i foldLanesSSE2(__m128i v) {
+    const __m128i low2 = _mm_set1_epi8(3);
+    const __m128i lowByte = _mm_set1_epi16(0x00FF);
+    const __m128i lowWord = _mm_set1_epi32(0x0000FFFF);
+
+    v = _mm_and_si128(v, low2);
+    v = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, lowByte), 2), _mm_srli_epi16(v, 8));   // d0<<2|d1, d2<<2|d3
+    return _mm_or_si128(_mm_slli_epi32(_mm_and_si128(v, lowWord), 4), _mm_srli_epi32(v, 16)); // d0<<6|d1<<4|d2<<2|d3
+}
+
+static void pack2bppSSE2(const uint8_t* dots, uint8_t* line, int width) {
+    int x = 0;
+    for (; x + 64 <= width; x += 64) {
+        const __m128i* src = reinterpret_cast<const __m128i*>(dots + x);
+        const __m128i a = foldLanesSSE2(_mm_loadu_si128(src + 0));
+        const __m128i b = foldLanesSSE2(_mm_loadu_si128(src + 1));
+        const __m128i c = foldLanesSSE2(_mm_loadu_si128(src + 2));
+        const __m128i d = foldLanesSSE2(_mm_loadu_si128(src + 3));
+        const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(line + x / 4), packed);
+    }
+    pack2bppScalar(dots + x, line + x / 4, width - x);
+}
+
+
+// === AVX2 ===
+
+__attribute__((target("avx2")))
+static void thresholdAVX2(const uint8_t* ink, const uint8_t* mask, uint8_t* dithered, int width) {
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        const __m256i u = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ink + x));
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask + x));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dithered + x), _mm256_cmpeq_epi8(_mm256_max_epu8(u, v), u));
+    }
+    thresholdSSE2(ink + x, mask + x, dithered + x, width - x);
+}
+
+__attribute__((target("avx2")))
+static void classifyAVX2(const uint8_t* dithered, const uint8_t* mask, uint8_t* dots, int width) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i three = _mm256_set1_epi8(3);
+    const __m256i t192 = _mm256_set1_epi8(static_cast<char>(192));
+
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dithered + x));
+        const __m256i t = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask + x));
+        const __m256i hasDot = _mm256_cmpgt_epi8(zero, d);
+        const __m256i ge128 = _mm256_cmpgt_epi8(zero, t);
+        const __m256i ge192 = _mm256_cmpeq_epi8(_mm256_max_epu8(t, t192), t);
+        const __m256i level = _mm256_add_epi8(three, _mm256_add_epi8(ge128, ge192));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dots + x), _mm256_and_si256(level, hasDot));
+    }
+    classifySSE2(dithered + x, mask + x, dots + x, width - x);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i foldLanesAVX2(__m256i v) {
+    v = _mm256_and_si256(v, _mm256_set1_epi8(3));
+    v = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(v, _mm256_set1_epi16(0x00FF)), 2), _mm256_srli_epi16(v, 8));
+    return _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(v, _mm256_set1_epi32(0x0000FFFF)), 4), _mm256_srli_epi32(v, 16));
+}
+
+__attribute__((target("avx2")))
+static void pack2bppAVX2(const uint8_t* dots, uint8_t* line, int width) {
+    // Packs work per 128-bit lane; the permute restores pixel order across lanes
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    int x = 0;
+    for (; x + 128 <= width; x += 128) {
+        const __m256i* src = reinterpret_cast<const __m256i*>(dots + x);
+        const __m256i a = foldLanesAVX2(_mm256_loadu_si256(src + 0));
+        const __m256i b = foldLanesAVX2(_mm256_loadu_si256(src + 1));
+        const __m256i c = foldLanesAVX2(_mm256_loadu_si256(src + 2));
+        const __m256i d = foldLanesAVX2(_mm256_loadu_si256(src + 3));
+        const __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(line + x / 4), _mm256_permutevar8x32_epi32(packed, order));
+    }
+    pack2bppSSE2(dots + x, line + x / 4, width - x);
+}
+
+#endif // NOCAI_KERNELS_X86
+
+
+// === Dispatch ===
+
+static const Table scalarTable = { Isa::Scalar, thresholdScalar, classifyScalar, pack2bppScalar };
+#ifdef NOCAI_KERNELS_X86
+static const Table sse2Table = { Isa::SSE2, thresholdSSE2, classifySSE2, pack2bppSSE2 };
+static const Table avx2Table = { Isa::AVX2, thresholdAVX2, classifyAVX2, pack2bppAVX2 };
+#endif
+
+
+static bool isSupported(Isa isa) {
+    switch (isa) {
+    case Isa::Scalar: return true;
+#ifdef NOCAI_KERNELS_X86
+    case Isa::SSE2: return __builtin_cpu_supports("sse2");
+    case Isa::AVX2: return __builtin_cpu_supports("avx2");
+#endif
+    default: return false;
+    }
+}
+
+
+const Table& forIsa(Isa isa) {
+#ifdef NOCAI_KERNELS_X86
+    if (isa == Isa::AVX2 && isSupported(Isa::AVX2)) return avx2Table;
+    if (isa != Isa::Scalar && isSupported(Isa::SSE2)) return sse2Table;
+#else
+    (void) isSupported;
+    (void) isa;
+#endif
+    return scalarTable;
+}
+
+
+const Table& active() {
+    static const Table& table = [] () -> const Table& {
+        const char* env = std::getenv("RIP_KERNELS");
+        if (env && std::strcmp(env, "scalar") == 0) return forIsa(Isa::Scalar);
+        if (env && std::strcmp(env, "sse2") == 0) return forIsa(Isa::SSE2);
+        return forIsa(Isa::AVX2);
+    }();
+    return table;
+}
+
+
+const char* isaName(Isa isa) {
+    switch (isa) {
+    case Isa::SSE2: return "SSE2";
+    case Isa::AVX2: return "AVX2";
+    default: return "scalar";
+    }
+}
+
+}
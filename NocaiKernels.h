@@ -0,0 +1,50 @@
+// NocaiKernels.h
+#pragma once
+
+#include "ImagePlane.h"
+#include <cstdint>
+
+
+/*******************************************************************************************
+    Per-pixel kernels of the Nocai screening pipeline. Every kernel has a scalar version
+    plus SSE2 and AVX2 versions on x86; active() picks the best one the CPU supports once
+    per process. All versions produce bit-identical output.
+
+        threshold   dithered = ink >= mask ? 255 : 0             (magick -fx 'u>=v?1:0')
+        classify    dots = dithered < 128 ? 0 : mask >= 192 ? 1 : mask >= 128 ? 2 : 3
+        pack2bpp    4 dot levels per byte, first pixel in the two most significant bits
+********************************************************************************************/
+
+namespace NocaiKernels {
+
+enum class Isa { Scalar, SSE2, AVX2 };
+
+struct Table {
+    Isa isa;
+    void (*threshold)(const uint8_t* ink, const uint8_t* mask, uint8_t* dithered, int width);
+    void (*classify)(const uint8_t* dithered, const uint8_t* mask, uint8_t* dots, int width);
+    void (*pack2bpp)(const uint8_t* dots, uint8_t* line, int width);   // Writes (width + 3) / 4 bytes
+};
+
+const Table& active();                  // Best kernels for this CPU (RIP_KERNELS=scalar|sse2|avx2 overrides)
+const Table& forIsa(Isa isa);           // Specific kernels, or the best supported ones below isa
+const char* isaName(Isa isa);
+
+
+// Plane-level wrappers: apply a row kernel to every row of equally sized planes
+inline void threshold(const PlaneView& ink, const PlaneView& mask, const PlaneView& dithered, const Table& k = active()) {
+    for (int y = 0; y < ink.height; ++y)
+        k.threshold(ink.row(y), mask.row(y), dithered.row(y), ink.width);
+}
+
+inline void classify(const PlaneView& dithered, const PlaneView& mask, const PlaneView& dots, const Table& k = active()) {
+    for (int y = 0; y < dithered.height; ++y)
+        k.classify(dithered.row(y), mask.row(y), dots.row(y), dithered.width);
+}
+
+inline void pack2bpp(const PlaneView& dots, const PlaneView& packed, const Table& k = active()) {
+    for (int y = 0; y < dots.height; ++y)
+        k.pack2bpp(dots.row(y), packed.row(y), dots.width);
+}
+
+}
@@ -0,0 +1,94 @@
+#include "PRNWriter.h"
+#include <QDebug>
+#include <cerrno>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#endif
+
+
+// Create the file at its final size, write the header and map the line area
+bool PRNWriter::open(const QString& localPath, const uint32_t (&header)[HeaderFields], int lineBytes, int height, int maxBandRows) {
+    close();
+
+    m_lineBytes = lineBytes;
+    m_height = height;
+    m_failed = false;
+
+    m_file.setFileName(localPath);
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        qWarning() << "Failed to open output file for writing:" << localPath;
+        return false;
+    }
+
+    const qint64 fileSize = lineOffset(height);
+
+#ifdef Q_OS_UNIX
+    // Reserve the blocks up front: a full disk is reported here, not as SIGBUS on a mapped store
+    const int err = posix_fallocate(m_file.handle(), 0, fileSize);
+    if (err != 0 && err != EOPNOTSUPP && err != EINVAL) {
+        qWarning() << "Failed to preallocate PRN file:" << localPath << std::strerror(err);
+        m_file.close();
+        return false;
+    }
+#endif
+
+    if (!m_file.resize(fileSize) || m_file.write(reinterpret_cast<const char*>(header), sizeof(header)) != qint64(sizeof(header))) {
+        qWarning() << "Failed to size PRN file:" << localPath << m_file.errorString();
+        m_file.close();
+        return false;
+    }
+
+    if (height > 0 && lineBytes > 0)
+        m_mapped = m_file.map(lineOffset(0), fileSize - lineOffset(0));
+
+    if (!m_mapped) {
+        m_file.unsetError();
+
+        // Lines are only ever partly overwritten, so zero the padding once
+        m_staging.reset(lineBytes, maxBandRows, 4);
+        m_staging.fill(0);
+    }
+
+    return true;
+}
+
+
+PlaneView PRNWriter::rows(int y0, int count) {
+    if (m_mapped)
+        return { m_mapped + static_cast<ptrdiff_t>(y0) * m_lineBytes, m_lineBytes, count, m_lineBytes };
+    return m_staging.view().rows(0, count);
+}
+
+
+bool PRNWriter::commit(int y0, int count) {
+    if (m_failed) return false;
+    if (m_mapped || count <= 0) return true;
+
+    const qint64 bytes = static_cast<qint64>(m_staging.stride()) * count;
+    if (!m_file.seek(lineOffset(y0)) || m_file.write(reinterpret_cast<const char*>(m_staging.data()), bytes) != bytes) {
+        qWarning() << "PRN write failed:" << m_file.errorString();
+        m_failed = true;
+    }
+    return !m_failed;
+}
+
+
+// Unmap and close; false if any write failed
+bool PRNWriter::close() {
+    if (!m_file.isOpen()) return !m_failed;
+
+    if (m_mapped) {
+        m_file.unmap(m_mapped);
+        m_mapped = nullptr;
+    }
+
+    m_file.unsetError();
+    m_file.close();
+    if (m_file.error() != QFileDevice::NoError && !m_failed) {
+        qWarning() << "PRN close failed:" << m_file.errorString();
+        m_failed = true;
+    }
+    return !m_failed;
+}
@@ -0,0 +1,45 @@
+// PRNWriter.h
+#pragma once
+
+#include "ImagePlane.h"
+#include <QFile>
+#include <QString>
+#include <cstdint>
+
+
+/*******************************************************************************************
+    PRNWriter owns a Nocai PRN file of known size: a 12 x uint32 header followed by
+    height lines of lineBytes each. The file is preallocated at open() and mapped, so
+    rows() hands out pointers at the final file offsets and any number of workers can
+    fill disjoint rows at once with no copy or write call per row.
+
+    If the file cannot be mapped, rows() returns a staging band instead and commit()
+    writes it with one call at its offset.
+
+    Usage per page:
+        open() -> { rows() -> fill -> commit() }* -> close()
+********************************************************************************************/
+
+class PRNWriter {
+public:
+    static constexpr int HeaderFields = 12;
+
+    ~PRNWriter() { close(); }
+
+    bool open(const QString& localPath, const uint32_t (&header)[HeaderFields], int lineBytes, int height, int maxBandRows);
+    PlaneView rows(int y0, int count);      // Destination for lines [y0, y0 + count); unwritten bytes stay zero
+    bool commit(int y0, int count);         // Hand the lines filled through rows() to the file
+    bool close();
+
+    bool isMapped() const { return m_mapped != nullptr; }
+
+private:
+    QFile m_file;
+    uchar* m_mapped = nullptr;
+    ImagePlane m_staging;                   // Band buffer when the file is not mapped
+    int m_lineBytes = 0;
+    int m_height = 0;
+    bool m_failed = false;
+
+    qint64 lineOffset(int y) const { return static_cast<qint64>(sizeof(uint32_t)) * HeaderFields + static_cast<qint64>(y) * m_lineBytes; }
+};
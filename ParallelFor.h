@@ -0,0 +1,38 @@
+// ParallelFor.h
+#pragma once
+
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+
+/*****************************************************************************************
+    parallelFor splits [0, count) into contiguous ranges of at least minChunk items and
+    runs fn(begin, end) for each range on the given pool, blocking until all are done.
+    Without a pool, or when the work fits one range, fn runs inline on the caller.
+******************************************************************************************/
+
+template <typename Fn>
+void parallelFor(QThreadPool* pool, int count, Fn&& fn, int minChunk = 1) {
+    if (count <= 0) return;
+
+    const int workers = pool ? pool->maxThreadCount() : 1;
+    const int chunks = std::min({ workers * 4, count / std::max(1, minChunk), count });
+
+    if (!pool || workers <= 1 || chunks <= 1) {
+        fn(0, count);
+        return;
+    }
+
+    std::vector<std::pair<int, int>> ranges;
+    ranges.reserve(chunks);
+    for (int i = 0; i < chunks; ++i)
+        ranges.emplace_back(static_cast<int>(static_cast<long long>(count) * i / chunks),
+                            static_cast<int>(static_cast<long long>(count) * (i + 1) / chunks));
+
+    QtConcurrent::blockingMap(pool, ranges, [&fn](std::pair<int, int>& range) {
+        fn(range.first, range.second);
+    });
+}
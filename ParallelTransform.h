@@ -0,0 +1,88 @@
+// ParallelTransform.h
+#pragma once
+
+#include <QDebug>
+#include <QThreadPool>
+#include <lcms2.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "ParallelFor.h"
+
+
+/*****************************************************************************************
+    parallelTransform runs an lcms2 transform over a width x height image as row bands
+    on the pool. The transform must be built with cmsFLAGS_NOCACHE (TransformCache
+    always does), which makes cmsDoTransform safe to call from several threads at once.
+
+    Strides are derived from the transform's own formats, so packed and planar buffers
+    both work; a planar buffer holds one full width x height plane per channel. lcms2
+    takes strides as 32 bits, so images whose rows or planes are 4 GiB or more are
+    refused rather than wrapped.
+******************************************************************************************/
+
+namespace ParallelTransformDetail {
+
+// Bytes in one sample of a packed or planar lcms2 format (T_BYTES 0 means double)
+inline size_t sampleBytes(cmsUInt32Number format) {
+    const cmsUInt32Number bytes = T_BYTES(format);
+    return bytes == 0 ? sizeof(double) : bytes;
+}
+
+inline size_t samplesPerPixel(cmsUInt32Number format) {
+    return static_cast<size_t>(T_CHANNELS(format)) + T_EXTRA(format);
+}
+
+// Offset of row y, and bytes from one row (packed) or plane (planar) to the next
+inline size_t rowOffset(cmsUInt32Number format, int width, int y) {
+    const size_t pixelBytes = T_PLANAR(format) ? sampleBytes(format) : sampleBytes(format) * samplesPerPixel(format);
+    return static_cast<size_t>(y) * width * pixelBytes;
+}
+
+inline cmsUInt32Number lineStride(cmsUInt32Number format, int width) {
+    return static_cast<cmsUInt32Number>(rowOffset(format, width, 1));
+}
+
+inline cmsUInt32Number planeStride(cmsUInt32Number format, int width, int height) {
+    return T_PLANAR(format) ? static_cast<cmsUInt32Number>(rowOffset(format, width, height)) : 0;
+}
+
+inline bool stridesFit(cmsUInt32Number format, int width, int height) {
+    const size_t span = rowOffset(format, width, T_PLANAR(format) ? height : 1);
+    return span <= std::numeric_limits<cmsUInt32Number>::max();
+}
+
+}
+
+
+// Rows per task are sized to ~64K pixels so narrow images still split into useful bands.
+// False, with nothing written, if a stride does not fit lcms2's 32 bits.
+inline bool parallelTransform(QThreadPool* pool, cmsHTRANSFORM transform,
+                              const void* input, void* output, int width, int height) {
+    if (!transform || width <= 0 || height <= 0)
+        return false;
+
+    using namespace ParallelTransformDetail;
+
+    const cmsUInt32Number inFormat = cmsGetTransformInputFormat(transform);
+    const cmsUInt32Number outFormat = cmsGetTransformOutputFormat(transform);
+    if (!stridesFit(inFormat, width, height) || !stridesFit(outFormat, width, height)) {
+        qWarning() << "Image too large for one ICC transform:" << width << "x" << height;
+        return false;
+    }
+
+    const int minRows = std::max(1, 65536 / width);
+
+    parallelFor(pool, height, [&](int begin, int end) {
+        const uint8_t* src = static_cast<const uint8_t*>(input) + rowOffset(inFormat, width, begin);
+        uint8_t* dst = static_cast<uint8_t*>(output) + rowOffset(outFormat, width, begin);
+
+        cmsDoTransformLineStride(transform, src, dst,
+                                 static_cast<cmsUInt32Number>(width), static_cast<cmsUInt32Number>(end - begin),
+                                 lineStride(inFormat, width), lineStride(outFormat, width),
+                                 planeStride(inFormat, width, height), planeStride(outFormat, width, height));
+    }, minRows);
+    return true;
+}
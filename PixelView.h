@@ -0,0 +1,70 @@
+// PixelView.h
+#pragma once
+
+#include <Magick++.h>
+#include <cstddef>
+#include <vector>
+
+
+/******************************************************************************************
+    PixelView moves float samples in and out of a Magick image through a cache view of
+    its own. ExportImagePixels and ImportImagePixels use the image's nexus for the
+    calling OpenMP thread, which is nexus 0 on every QThreadPool thread, so workers on
+    one image would share the buffer that virtual pixels and disk or mapped caches pass
+    through. Each worker opens its own PixelView instead.
+
+    Samples are scaled to [0, 1] and picked by PixelChannel, as ExportImagePixels does
+    for FloatPixel storage and a channel map.
+*******************************************************************************************/
+
+class PixelView {
+public:
+    using Channels = std::vector<MagickCore::PixelChannel>;
+
+    // A writable view needs an image that is already unshared (Image::modifyImage)
+    PixelView(const MagickCore::Image* image, bool writable)
+        : m_image(image), m_exception(MagickCore::AcquireExceptionInfo()) {
+        m_view = writable ? MagickCore::AcquireAuthenticCacheView(image, m_exception)
+                          : MagickCore::AcquireVirtualCacheView(image, m_exception);
+    }
+
+    ~PixelView() {
+        MagickCore::DestroyCacheView(m_view);
+        MagickCore::DestroyExceptionInfo(m_exception);
+    }
+
+    PixelView(const PixelView&) = delete;
+    PixelView& operator=(const PixelView&) = delete;
+
+    // Samples of (x, y, columns, rows); outside the image they are its virtual pixels
+    bool read(ssize_t x, ssize_t y, size_t columns, size_t rows, const Channels& channels, float* samples) {
+        const MagickCore::Quantum* p = MagickCore::GetCacheViewVirtualPixels(m_view, x, y, columns, rows, m_exception);
+        if (!p)
+            return false;
+
+        const size_t step = MagickCore::GetPixelChannels(m_image);
+        for (size_t i = 0; i < columns * rows; ++i, p += step)
+            for (MagickCore::PixelChannel channel : channels)
+                *samples++ = static_cast<float>(QuantumScale * MagickCore::GetPixelChannel(m_image, channel, p));
+        return true;
+    }
+
+    // Replace channels of (x, y, columns, rows), which must lie inside the image; the
+    // region is read first so the other channels (alpha) keep their values
+    bool write(ssize_t x, ssize_t y, size_t columns, size_t rows, const Channels& channels, const float* samples) {
+        MagickCore::Quantum* q = MagickCore::GetCacheViewAuthenticPixels(m_view, x, y, columns, rows, m_exception);
+        if (!q)
+            return false;
+
+        const size_t step = MagickCore::GetPixelChannels(m_image);
+        for (size_t i = 0; i < columns * rows; ++i, q += step)
+            for (MagickCore::PixelChannel channel : channels)
+                MagickCore::SetPixelChannel(m_image, channel, MagickCore::ClampToQuantum(QuantumRange * *samples++), q);
+        return MagickCore::SyncCacheViewAuthenticPixels(m_view, m_exception) != MagickCore::MagickFalse;
+    }
+
+private:
+    const MagickCore::Image* m_image;
+    MagickCore::ExceptionInfo* m_exception;
+    MagickCore::CacheView* m_view;
+};
@@ -0,0 +1,187 @@
+#include "PointKernel.h"
+#include "ParallelFor.h"
+#include "PixelView.h"
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+using namespace Magick;
+
+
+namespace {
+
+constexpr double Epsilon = 1.0e-12;
+
+// MagickCore's ConvertRGBToHSL, on values scaled to [0, 1]
+void rgbToHsl(double red, double green, double blue, double &hue, double &saturation, double &lightness) {
+    const double max = std::max({ red, green, blue });
+    const double min = std::min({ red, green, blue });
+    const double c = max - min;
+
+    lightness = (max + min) / 2.0;
+    if (c <= 0.0) {
+        hue = 0.0;
+        saturation = 0.0;
+        return;
+    }
+
+    if (std::fabs(max - red) < Epsilon) {
+        hue = (green - blue) / c;
+        if (green < blue)
+            hue += 6.0;
+    } else if (std::fabs(max - green) < Epsilon) {
+        hue = 2.0 + (blue - red) / c;
+    } else {
+        hue = 4.0 + (red - green) / c;
+    }
+    hue *= 60.0 / 360.0;
+
+    const double denominator = lightness <= 0.5 ? 2.0 * lightness : 2.0 - 2.0 * lightness;
+    saturation = std::fabs(denominator) < Epsilon ? c / Epsilon : c / denominator;
+}
+
+
+// MagickCore's ConvertHSLToRGB
+void hslToRgb(double hue, double saturation, double lightness, double &red, double &green, double &blue) {
+    double h = hue * 360.0;
+    const double c = (lightness <= 0.5 ? 2.0 * lightness : 2.0 - 2.0 * lightness) * saturation;
+    const double min = lightness - 0.5 * c;
+
+    h -= 360.0 * std::floor(h / 360.0);
+    h /= 60.0;
+    const double x = c * (1.0 - std::fabs(h - 2.0 * std::floor(h / 2.0) - 1.0));
+
+    switch (static_cast<int>(std::floor(h))) {
+    case 0:  red = min + c; green = min + x; blue = min;     break;
+    case 1:  red = min + x; green = min + c; blue = min;     break;
+    case 2:  red = min;     green = min + c; blue = min + x; break;
+    case 3:  red = min;     green = min + x; blue = min + c; break;
+    case 4:  red = min + x; green = min;     blue = min + c; break;
+    case 5:  red = min + c; green = min;     blue = min + x; break;
+    default: red = 0.0;     green = 0.0;     blue = 0.0;     break;
+    }
+}
+
+
+float clamp01(double value) {
+    return static_cast<float>(std::clamp(value, 0.0, 1.0));
+}
+
+}
+
+
+PointKernel::Op PointKernel::modulate(double brightness, double saturation, double hue) {
+    Op op;
+    op.kind = Op::Modulate;
+    op.brightness = brightness;
+    op.saturation = saturation;
+    op.hue = hue;
+    return op;
+}
+
+
+PointKernel::Op PointKernel::gamma(double gamma) {
+    Op op;
+    op.kind = Op::Gamma;
+    op.gamma = gamma;
+    return op;
+}
+
+
+// (x^(1/a))^(1/b) is x^(1/ab), so a run of gammas costs one pow
+void PointKernel::append(const Op &op) {
+    if (op.kind == Op::Gamma && !m_ops.empty() && m_ops.back().kind == Op::Gamma)
+        m_ops.back().gamma *= op.gamma;
+    else
+        m_ops.push_back(op);
+}
+
+
+void PointKernel::apply(Image &image) const {
+    if (m_ops.empty())
+        return;
+
+    const ColorspaceType colorspace = image.colorSpace();
+    if (colorspace == GRAYColorspace || colorspace == LinearGRAYColorspace) {
+        image.colorSpace(sRGBColorspace);
+    } else if (colorspace != sRGBColorspace && colorspace != RGBColorspace) {
+        applyNative(image);
+        return;
+    }
+
+    const size_t columns = image.columns();
+    const int rows = static_cast<int>(image.rows());
+    const int bands = (rows + BandRows - 1) / BandRows;
+
+    // Unshare the pixels once here, since image() alone would write through to every
+    // copy (history checkpoints, the preview); bands then write disjoint regions
+    image.modifyImage();
+    const MagickCore::Image *pixels = image.image();
+    const PixelView::Channels rgb = { MagickCore::RedPixelChannel, MagickCore::GreenPixelChannel,
+                                      MagickCore::BluePixelChannel };
+    std::atomic_bool failed(false);
+
+    parallelFor(QThreadPool::globalInstance(), bands, [&](int begin, int end) {
+        std::vector<float> band(columns * BandRows * 3);
+        PixelView view(pixels, true);
+
+        for (int b = begin; b < end && !failed; ++b) {
+            const ssize_t y = static_cast<ssize_t>(b) * BandRows;
+            const size_t count = std::min<size_t>(BandRows, rows - y);
+
+            if (!view.read(0, y, columns, count, rgb, band.data())) {
+                failed = true;
+                break;
+            }
+            applyPixels(band.data(), columns * count);
+            if (!view.write(0, y, columns, count, rgb, band.data()))
+                failed = true;
+        }
+    });
+
+    if (failed)
+        throw ErrorCache("PointKernel: could not transfer image pixels");
+}
+
+
+// One call per op, for colour spaces the HSL maths does not apply to
+void PointKernel::applyNative(Image &image) const {
+    for (const Op &op : m_ops) {
+        if (op.kind == Op::Modulate)
+            image.modulate(op.brightness, op.saturation, op.hue);
+        else
+            image.gamma(op.gamma);
+    }
+}
+
+
+void PointKernel::applyPixels(float *rgb, size_t count) const {
+    for (size_t i = 0; i < count; ++i, rgb += 3) {
+        double red = rgb[0], green = rgb[1], blue = rgb[2];
+
+        for (const Op &op : m_ops) {
+            if (op.kind == Op::Modulate) {
+                double hue, saturation, lightness;
+                rgbToHsl(red, green, blue, hue, saturation, lightness);
+                hue += std::fmod(op.hue - 100.0, 200.0) / 200.0;
+                saturation *= 0.01 * op.saturation;
+                lightness *= 0.01 * op.brightness;
+                hslToRgb(hue, saturation, lightness, red, green, blue);
+                red = clamp01(red);
+                green = clamp01(green);
+                blue = clamp01(blue);
+            } else if (op.gamma != 1.0) {
+                // GammaImage's exponent, including its reciprocal of a near-zero gamma
+                const double exponent = std::fabs(op.gamma) < Epsilon ? 1.0 / Epsilon : 1.0 / op.gamma;
+                red = red > 0.0 ? std::pow(red, exponent) : red;
+                green = green > 0.0 ? std::pow(green, exponent) : green;
+                blue = blue > 0.0 ? std::pow(blue, exponent) : blue;
+            }
+        }
+
+        rgb[0] = clamp01(red);
+        rgb[1] = clamp01(green);
+        rgb[2] = clamp01(blue);
+    }
+}
@@ -0,0 +1,51 @@
+// PointKernel.h
+#pragma once
+
+#include <Magick++.h>
+#include <vector>
+
+
+/*******************************************************************************************
+    PointKernel runs a list of per-pixel adjustments over an image in a single pass.
+    Each ImageMagick call would read and write every pixel once per adjustment; here the
+    image is streamed through in row bands, each band exported once, run through every
+    adjustment in turn while it is in cache, and imported back.
+
+    The maths follows ImageMagick's own ModulateImage (HSL) and GammaImage, clamping
+    between adjustments as ImageMagick does when it stores each result, so a fused run
+    matches the separate calls. Adjacent gammas are merged into one power.
+
+    RGB images are processed directly; gray images are converted to sRGB first, as
+    modulate would. Any other colour space falls back to the ImageMagick calls.
+********************************************************************************************/
+
+class PointKernel {
+public:
+    struct Op {
+        enum Kind { Modulate, Gamma };
+        Kind kind = Modulate;
+        double brightness = 100.0;      // Modulate percentages, 100 leaves the channel alone
+        double saturation = 100.0;
+        double hue = 100.0;
+        double gamma = 1.0;
+    };
+
+    static constexpr int BandRows = 64;
+
+    static Op modulate(double brightness, double saturation, double hue);
+    static Op gamma(double gamma);
+
+    void append(const Op &op);
+    void clear() { m_ops.clear(); }
+    bool isEmpty() const { return m_ops.empty(); }
+    int size() const { return static_cast<int>(m_ops.size()); }
+
+    // Apply every op in order; throws Magick::Exception like the calls it replaces
+    void apply(Magick::Image &image) const;
+
+private:
+    std::vector<Op> m_ops;
+
+    void applyNative(Magick::Image &image) const;
+    void applyPixels(float *rgb, size_t count) const;
+};
@@ -1,4 +1,10 @@
 #include "PrintJobNocai.h"
+#include "NocaiBandPipeline.h"
+#include "MaskCache.h"
+#include "ColorLUT.h"
+#include "TransformCache.h"
+#include "ParallelFor.h"
+#include <QThread>
 #include <lcms2.h>
 #include <QTemporaryDir>
 #include <QTemporaryFile>
@@ -8,36 +14,41 @@
 #include <QDebug>
 #include <QUrl>
 #include <fstream>
+#include <algorithm>
+#include <limits>
 
 
 // Constructor
-PrintJobNocai::PrintJobNocai(QObject* parent) : QObject(parent) {}
-
+PrintJobNocai::PrintJobNocai(QObject* parent) : QObject(parent) {
+    setWorkerCount(0);
+}
 
-// Load image and copy to a temporary location
-bool PrintJobNocai::loadInputImage(const QString& imagePath) {
-    try {
-        QString localPath = QUrl(imagePath).toLocalFile();
-        inputImage.read(localPath.toStdString());
 
-        QFileInfo fileInfo(localPath);
-        originalFilename = fileInfo.fileName();
+// Threads used to screen a page; the output does not depend on the count
+void PrintJobNocai::setWorkerCount(int count) {
+    screeningPool.setMaxThreadCount(count > 0 ? count : QThread::idealThreadCount());
+}
 
-        tempDir = std::make_unique<QTemporaryDir>();
-        if (!tempDir->isValid()) {
-            qWarning() << "Failed to create temp dir";
-            return false;
-        }
 
-        tempImagePath = tempDir->filePath(originalFilename);
-        inputImage.write(tempImagePath.toStdString());
+// Open the input image; rows are decoded a band at a time by generateFinalPRN
+bool PrintJobNocai::loadInputImage(const QString& imagePath) {
+    stageTimer.clear();
+    stageTimer.restart();
 
-        qDebug() << "Loaded and copied input image to:" << tempImagePath;
-        return true;
-    } catch (const Magick::Exception& e) {
-        qWarning() << "Image load failed:" << e.what();
+    QString localPath = QUrl(imagePath).toLocalFile();
+    inputReader = ScanlineReader::open(localPath);
+    if (!inputReader)
         return false;
-    }
+    if (inputReader->holdsWholeImage())
+        stageTimer.countCopy();
+
+    inputPath = localPath;
+    QFileInfo fileInfo(localPath);
+    originalFilename = fileInfo.fileName();
+
+    stageTimer.lap("open");
+    qDebug() << "Loaded input image:" << localPath;
+    return true;
 }
 
 
@@ -48,224 +59,140 @@ Magick::Blob PrintJobNocai::loadICCProfile(const QString& path) {
 }
 
 
+/*
+    Only builds the conversion: the baked LUT, or the Little CMS transform when no LUT is
+    within tolerance. generateFinalPRN decodes, converts and screens the page a band at
+    a time with it, so no page-sized separations are ever held.
+*/
 bool PrintJobNocai::applyICCConversion(const QString& inputProfile, const QString& outputProfile) {
-    try {
-        QString inPath = QUrl(inputProfile).toLocalFile();
-        QString outPath = QUrl(outputProfile).toLocalFile();
-
-        // Load ICC profiles
-        cmsHPROFILE inputICC = cmsOpenProfileFromFile(inPath.toStdString().c_str(), "r");
-        cmsHPROFILE outputICC = cmsOpenProfileFromFile(outPath.toStdString().c_str(), "r");
-        if (!inputICC || !outputICC) {
-            qWarning() << "❌ Failed to load one or both ICC profiles.";
-            if (inputICC) cmsCloseProfile(inputICC);
-            if (outputICC) cmsCloseProfile(outputICC);
-            return false;
-        }
-
-        // Create Little CMS transform
-        cmsHTRANSFORM transform = cmsCreateTransform(inputICC, TYPE_RGB_8,
-                                                     outputICC, TYPE_CMYK_8,
-                                                     INTENT_PERCEPTUAL, 0);
-        if (!transform) {
-            qWarning() << "❌ Failed to create ICC transform.";
-            cmsCloseProfile(inputICC);
-            cmsCloseProfile(outputICC);
-            return false;
-        }
-
-        // Prepare input and output buffers
-        int width = static_cast<int>(inputImage.columns());
-        int height = static_cast<int>(inputImage.rows());
-        std::vector<uchar> rgbBuffer(width * height * 3);
-        std::vector<uchar> cmykBuffer(width * height * 4);
-
-        inputImage.type(Magick::TrueColorType);
-        inputImage.colorSpace(Magick::RGBColorspace);
-        inputImage.write(0, 0, width, height, "RGB", Magick::CharPixel, rgbBuffer.data());
-
-        // Apply color conversion
-        cmsDoTransform(transform, rgbBuffer.data(), cmykBuffer.data(), width * height);
-
-        cmsDeleteTransform(transform);
-        cmsCloseProfile(inputICC);
-        cmsCloseProfile(outputICC);
-
-        // Create CMYK Magick image
-        cmykImage = Magick::Image(Magick::Geometry(width, height), "white");
-        cmykImage.depth(8);
-        cmykImage.type(Magick::TrueColorType);
-        cmykImage.colorSpace(Magick::CMYKColorspace);
-        cmykImage.read(width, height, "CMYK", Magick::CharPixel, cmykBuffer.data());
-
-        // Embed the output ICC profile into CMYK image
-        std::ifstream profileFile(outPath.toStdString(), std::ios::binary);
-        if (profileFile) {
-            std::vector<char> profileData((std::istreambuf_iterator<char>(profileFile)), {});
-            Magick::Blob profileBlob(profileData.data(), profileData.size());
-            cmykImage.profile("icc", profileBlob);
-        }
-
-        // Extract CMYK channels
-        cmykChannels = separateCMYK(cmykImage);
-
-        qDebug() << "✅ ICC conversion succeeded using:" << inPath << "→" << outPath;
-        return true;
+    if (!inputReader) {
+        qWarning() << "❌ No input image; run loadInputImage first.";
+        return false;
+    }
 
-    } catch (const Magick::Exception& e) {
-        qWarning() << "❌ Exception during ICC conversion:" << e.what();
+    QString inPath = QUrl(inputProfile).toLocalFile();
+    QString outPath = QUrl(outputProfile).toLocalFile();
+
+    const QByteArray inputICC = TransformCache::instance().profileData(inPath);
+    const QByteArray outputICC = TransformCache::instance().profileData(outPath);
+
+    // Baked 3D LUT when one is within tolerance of lcms2, otherwise the shared Little CMS transform
+    inputLUT = clutMaxDeltaE > 0
+        ? ColorLUT::forProfiles(inputICC, outputICC, INTENT_PERCEPTUAL, clutMaxDeltaE)
+        : nullptr;
+    inputTransform = inputLUT
+        ? nullptr
+        : TransformCache::instance().transform(inputICC, TYPE_RGB_8, outputICC, TYPE_CMYK_8_PLANAR, INTENT_PERCEPTUAL, 0);
+    if (!inputLUT && !inputTransform) {
+        qWarning() << "❌ Failed to load ICC profiles:" << inPath << outPath;
         return false;
     }
+
+    stageTimer.lap("setup");
+    qDebug() << "✅ ICC conversion prepared using:" << inPath << "→" << outPath;
+    return true;
 }
 
 
+/*
+    Streams the loaded input through the conversion from applyICCConversion and the band
+    pipeline: each band of RGB rows is decoded, converted into C, M, Y, K band planes,
+    screened, promoted, packed and written before the next one is read.
+    Full-image copies: decode, transform into the band planes.
+*/
 bool PrintJobNocai::generateFinalPRN(const QString& outputPath, int xdpi, int ydpi)
 {
-    try {
-        const QString localOutput = QUrl(outputPath).toLocalFile();
+    const QString localOutput = QUrl(outputPath).toLocalFile();
 
-        // === Hardcoded precomputed masks ===
-        const QString cMaskPath = "/home/mccalla/Downloads/precomputed_masks/mask_c.tiff";
-        const QString mMaskPath = "/home/mccalla/Downloads/precomputed_masks/mask_m.tiff";
-        const QString yMaskPath = "/home/mccalla/Downloads/precomputed_masks/mask_y.tiff";
-        const QString kMaskPath = "/home/mccalla/Downloads/precomputed_masks/mask_k.tiff";
-
-        const std::array<QString, 4> maskPaths = {cMaskPath, mMaskPath, yMaskPath, kMaskPath};
-        const std::array<int, 4> nocaiOrder = {2, 1, 0, 3}; // Y, M, C, K
+    if (!inputReader || (!inputLUT && !inputTransform)) {
+        qWarning() << "❌ No conversion; run loadInputImage and applyICCConversion first.";
+        return false;
+    }
 
-        std::array<std::vector<std::vector<uint8_t>>, 4> packedLines;
-        int width = static_cast<int>(cmykChannels[0].columns());
-        int height = static_cast<int>(cmykChannels[0].rows());
+    // Another PRN of the same input starts the decode over
+    if (inputReader->nextRow() > 0) {
+        inputReader = ScanlineReader::open(inputPath);
+        if (!inputReader)
+            return false;
+    }
 
-        for (int ch = 0; ch < 4; ++ch) {
-            Magick::Image& channelImg = cmykChannels[ch];
-            Magick::Image maskImg;
-            maskImg.read(maskPaths[ch].toStdString());
+    const int width = inputReader->width();
+    const int height = inputReader->height();
+    const int bandRows = NocaiBandPipeline::DefaultBandRows;
 
-            channelImg.type(Magick::GrayscaleType);
-            maskImg.type(Magick::GrayscaleType);
+    // Planar output: rows are one stride apart and each plane bandRows rows below the last.
+    // lcms takes the plane distance as 32 bits, which only an absurdly wide page exceeds
+    const uint64_t planeSize = static_cast<uint64_t>(ImagePlane::strideFor(width)) * bandRows;
+    if (planeSize > std::numeric_limits<cmsUInt32Number>::max()) {
+        qWarning() << "❌ Page too wide for the planar transform:" << width;
+        return false;
+    }
 
-            std::vector<uint8_t> channelBytes(width * height);
-            std::vector<uint8_t> maskBytes(width * height);
-            std::vector<uint8_t> dithered(width * height, 0);
+    ImagePlane separations(width, 4 * bandRows);            // C, M, Y, K band planes stacked
+    std::vector<uchar> rgbBand(static_cast<size_t>(width) * bandRows * 3);
+    auto separation = [&](int ch) { return separations.view().rows(ch * bandRows, bandRows); };
 
-            channelImg.write(0, 0, width, height, "I", Magick::CharPixel, channelBytes.data());
-            maskImg.write(0, 0, width, height, "I", Magick::CharPixel, maskBytes.data());
+    const cmsUInt32Number lineBytes = static_cast<cmsUInt32Number>(separations.stride());
+    const cmsUInt32Number planeBytes = static_cast<cmsUInt32Number>(planeSize);
 
-            // === FX Thresholding (equivalent to -fx 'u>=v?1:0') ===
-            for (int i = 0; i < width * height; ++i)
-                dithered[i] = (channelBytes[i] >= maskBytes[i]) ? 255 : 0;
+    // === Bundled blue noise masks, rolled per channel ===
+    std::array<MaskTile, 4> masks;
+    if (!MaskCache::channelTiles(512, masks))
+        return false;
 
-            // === Dot Classification Phase ===
-            std::vector<std::vector<uint8_t>> dotMap(height, std::vector<uint8_t>(width, 0));
-            for (int y = 0; y < height; ++y) {
-                for (int x = 0; x < width; ++x) {
-                    if (dithered[y * width + x] < 128) continue; // No dot
+    NocaiBandPipeline pipeline;
+    pipeline.setThreadPool(&screeningPool);
+    if (!pipeline.begin(localOutput, width, height, xdpi, ydpi, masks, bandRows))
+        return false;
+    stageTimer.lap("setup");
 
-                    uint8_t t = maskBytes[y * width + x];
-                    if (t >= 192) dotMap[y][x] = 1;
-                    else if (t >= 128) dotMap[y][x] = 2;
-                    else dotMap[y][x] = 3;
-                }
-            }
+    // === Decode, convert, screen, promote, pack and write one band at a time ===
+    for (int y0 = 0; y0 < height; y0 += bandRows) {
+        const int rows = std::min(bandRows, height - y0);
 
-            // === 4×4 Neighborhood Promotion ===
-            for (int y = 1; y < height - 2; ++y) {
-                for (int x = 1; x < width - 2; ++x) {
-                    if (dotMap[y][x] == 3) continue;
+        if (!inputReader->readRows(rgbBand.data(), rows))
+            return false;
+        stageTimer.lap("decode");
 
-                    int count = 0;
-                    for (int dy = -1; dy <= 2; ++dy)
-                        for (int dx = -1; dx <= 2; ++dx)
-                            if (dotMap[y + dy][x + dx] > 0)
-                                ++count;
+        // Convert row chunks in parallel, straight into the C, M, Y, K band planes
+        parallelFor(&screeningPool, rows, [&](int begin, int end) {
+            const uchar* rgb = rgbBand.data() + static_cast<size_t>(begin) * width * 3;
 
-                    if (count >= 12)
-                        dotMap[y][x] = 3;
-                }
+            if (!inputLUT) {
+                cmsDoTransformLineStride(inputTransform.get(), rgb, separation(0).row(begin),
+                                         static_cast<cmsUInt32Number>(width), static_cast<cmsUInt32Number>(end - begin),
+                                         static_cast<cmsUInt32Number>(width) * 3, lineBytes, 0, planeBytes);
+                return;
             }
 
-            // === Pack to 2BPP ===
-            const int bytesPerLine = (width + 3) / 4;
-            packedLines[ch].resize(height);
-
-            for (int y = 0; y < height; ++y) {
-                std::vector<uint8_t>& line = packedLines[ch][y];
-                line.reserve(bytesPerLine);
-                uint8_t byte = 0;
-                int idx = 0;
-
-                for (int x = 0; x < width; ++x) {
-                    uint8_t level = dotMap[y][x] & 0x03;
-                    byte |= level << ((3 - (idx % 4)) * 2);
-                    ++idx;
-
-                    if (idx % 4 == 0) {
-                        line.push_back(byte);
-                        byte = 0;
-                    }
-                }
-
-                if (idx % 4 != 0) line.push_back(byte);
-                while (line.size() % 4 != 0) line.push_back(0);
+            for (int r = begin; r < end; ++r, rgb += static_cast<size_t>(width) * 3) {
+                uint8_t* const planes[4] = { separation(0).row(r), separation(1).row(r),
+                                             separation(2).row(r), separation(3).row(r) };
+                inputLUT->apply(rgb, planes, width);
             }
-        }
-
-        // === PRN Header ===
-        std::ofstream out(localOutput.toStdString(), std::ios::binary);
-        const uint32_t bytesPerLineOut = static_cast<uint32_t>(packedLines[0][0].size());
-
-        uint32_t header[12] = {
-            0x00005555,
-            static_cast<uint32_t>(xdpi),
-            static_cast<uint32_t>(ydpi),
-            bytesPerLineOut,
-            static_cast<uint32_t>(height),
-            static_cast<uint32_t>(width),
-            0, 4, 1, 1, 0, 0
-        };
+        }, NocaiBandPipeline::MinRowsPerTask);
+        stageTimer.lap("icc");
 
-        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        pipeline.screenBands({ separation(0).rows(0, rows), separation(1).rows(0, rows),
+                               separation(2).rows(0, rows), separation(3).rows(0, rows) });
+        stageTimer.lap("screen");
 
-        for (int row = 0; row < height; ++row)
-            for (int ch : nocaiOrder)
-                out.write(reinterpret_cast<const char*>(packedLines[ch][row].data()), packedLines[ch][row].size());
-
-        out.close();
-        qDebug() << "✅ Final PRN file created:" << localOutput;
-        return true;
-
-    } catch (const Magick::Exception& e) {
-        qWarning() << "❌ PRN generation failed:" << e.what();
-        return false;
+        if (!pipeline.commitBand())
+            return false;
+        stageTimer.lap("output");
     }
-}
-
-
-std::array<Magick::Image, 4> PrintJobNocai::separateCMYK(Magick::Image& cmykImage) {
-    std::array<Magick::Image, 4> channels;
-    int width = static_cast<int>(cmykImage.columns());
-    int height = static_cast<int>(cmykImage.rows());
-
-    std::vector<uchar> rawCMYK(width * height * 4);
-    cmykImage.write(0, 0, width, height, "CMYK", Magick::CharPixel, rawCMYK.data());
-
-    for (int ch = 0; ch < 4; ++ch) {
-        std::vector<uchar> channelData(width * height);
-        for (int i = 0; i < width * height; ++i)
-            channelData[i] = rawCMYK[i * 4 + ch];
+    stageTimer.countCopy();     // Decode into the RGB bands
+    stageTimer.countCopy();     // Planar transform into the band planes
 
-        channels[ch] = Magick::Image(Magick::Geometry(width, height), "white");
-        channels[ch].depth(8);
-        channels[ch].type(Magick::GrayscaleType);
-        channels[ch].read(width, height, "I", Magick::CharPixel, channelData.data());
-    }
+    if (!pipeline.finish())
+        return false;
+    stageTimer.lap("output");
 
-    return channels;
+    qDebug() << "✅ Final PRN file created:" << localOutput;
+    return true;
 }
 
 
-
 /*
 bool PrintJobNocai::generateFinalPRN(const QString& outputPath, int xdpi, int ydpi)
 {
@@ -411,114 +338,11 @@ std::array<Magick::Image, 4> PrintJobNocai::separateCMYK(const Magick::Image& cm
 */
 
 
-std::vector<std::vector<uint8_t>> PrintJobNocai::dotClassification(const std::vector<uint8_t>& dithered, const std::vector<uint8_t>& mask, int width, int height) {
-    std::vector<std::vector<uint8_t>> dotMap(height, std::vector<uint8_t>(width, 0));
-
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            if (dithered[y * width + x] < 128) continue;
-
-            uint8_t t = mask[y * width + x];
-            if (t >= 192) dotMap[y][x] = 1;
-            else if (t >= 128) dotMap[y][x] = 2;
-            else dotMap[y][x] = 3;
-        }
-    }
-    return dotMap;
-}
-
-
-
-void PrintJobNocai::apply4x4Promotion(std::vector<std::vector<uint8_t>>& dotMap, int width, int height) {
-    for (int y = 1; y < height - 2; ++y) {
-        for (int x = 1; x < width - 2; ++x) {
-            if (dotMap[y][x] == 3) continue;
-
-            int count = 0;
-            for (int dy = -1; dy <= 2; ++dy)
-                for (int dx = -1; dx <= 2; ++dx)
-                    if (dotMap[y + dy][x + dx] > 0)
-                        ++count;
-
-            if (count >= 12)
-                dotMap[y][x] = 3;
-        }
-    }
-}
-
-
-std::vector<std::vector<uint8_t>> PrintJobNocai::packTo2BPP(const std::vector<std::vector<uint8_t>>& dotMap, int width, int height) {
-    const int bytesPerLine = (width + 3) / 4;
-    std::vector<std::vector<uint8_t>> packedLines(height);
-
-    for (int y = 0; y < height; ++y) {
-        std::vector<uint8_t>& line = packedLines[y];
-        line.reserve(bytesPerLine);
-        uint8_t byte = 0;
-        int idx = 0;
-
-        for (int x = 0; x < width; ++x) {
-            uint8_t level = dotMap[y][x] & 0x03;
-            byte |= level << ((3 - (idx % 4)) * 2);
-            ++idx;
-
-            if (idx % 4 == 0) {
-                line.push_back(byte);
-                byte = 0;
-            }
-        }
-
-        if (idx % 4 != 0) line.push_back(byte);
-        while (line.size() % 4 != 0) line.push_back(0);
-    }
-
-    return packedLines;
-}
-
-bool PrintJobNocai::writePRNFile(
-        const std::vector<std::vector<std::vector<uint8_t>>>& packedLines,
-        const std::vector<int>& channelOrder,
-        int width, int height, int xdpi, int ydpi,
-        const QString& outputPath)
-    {
-
-    QString outPath = QUrl(outputPath).toLocalFile();
-
-    std::ofstream out(outPath.toStdString(), std::ios::binary);
-    if (!out) {
-        qWarning() << "Failed to open output file for writing:" << outputPath;
-        return false;
-    }
-
-    uint32_t bytesPerLine = static_cast<uint32_t>(packedLines[0][0].size());
-
-    uint32_t header[12] = {
-        0x00005555,
-        static_cast<uint32_t>(xdpi),
-        static_cast<uint32_t>(ydpi),
-        bytesPerLine,
-        static_cast<uint32_t>(height),
-        static_cast<uint32_t>(width),
-        0, 4, 1, 1, 0, 0
-    };
-
-    out.write(reinterpret_cast<const char*>(header), sizeof(header));
-
-    for (int row = 0; row < height; ++row) {
-        for (int ch : channelOrder) {
-            out.write(reinterpret_cast<const char*>(packedLines[ch][row].data()), packedLines[ch][row].size());
-        }
-    }
-
-    out.close();
-    qDebug() << "Final PRN file created:" << outputPath;
-    return true;
-}
-
-
 void PrintJobNocai::runPRNGeneration(const QString& imagePath, const QString& outputPath, int xdpi, int ydpi) {
     (void) QtConcurrent::run([=]() {
-        bool success = generatePRNviaScript(imagePath, outputPath, xdpi, ydpi);
+        bool success = useScriptPipeline
+            ? generatePRNviaScript(imagePath, outputPath, xdpi, ydpi)
+            : generatePRNNative(imagePath, outputPath, xdpi, ydpi);
         emit prnGenerationFinished(success);
     });
 }
@@ -526,6 +350,9 @@ void PrintJobNocai::runPRNGeneration(const QString& imagePath, const QString& ou
 
 bool PrintJobNocai::generatePRNviaScript(const QString& imagePath, const QString& outputPath, int xdpi, int ydpi) {
 
+    stageTimer.clear();
+    stageTimer.restart();
+
     // 0. Create temp working directory for intermediary TIFFs
     std::unique_ptr<QTemporaryDir> workingDir = std::make_unique<QTemporaryDir>();
     QString tempPath = workingDir->path();
@@ -557,49 +384,235 @@ bool PrintJobNocai::generatePRNviaScript(const QString& imagePath, const QString
         qWarning() << "Script failed with exit code:" << process.exitCode();
         return false;
     }
+    stageTimer.lap("script");
 
-    // 3. Load intermediate TIFFs and masks
+    // 3. Load intermediate TIFFs and the rolled mask tiles they were dithered with
     QFileInfo fileInfo(imagePath);
     QString baseName = fileInfo.baseName();
     std::array<QString, 4> channels = { "c", "m", "y", "k" };
-    std::array<std::vector<std::vector<uint8_t>>, 4> packedLines;
+    std::array<Magick::Image, 4> ditherImages;
+    std::array<std::vector<uint8_t>, 4> maskBytes;
+    std::array<MaskTile, 4> masks;
 
     int width = 0, height = 0;
 
-    for (int i = 0; i < 4; ++i) {
-        QString ch = channels[i];
-        QString ditherPath = tempPath + QString("/%1_%2_1bit.tiff").arg(baseName, ch);
-        QString maskPath   = tempPath + QString("/%1_%2_mask.tiff").arg(baseName, ch);
-
-        Magick::Image ditherImage(ditherPath.toStdString());
-        Magick::Image maskImage(maskPath.toStdString());
+    try {
+        for (int i = 0; i < 4; ++i) {
+            QString ch = channels[i];
+            ditherImages[i].read((tempPath + QString("/%1_%2_1bit.tiff").arg(baseName, ch)).toStdString());
+
+            // Already rolled; MaskTile repeats it across the page as -virtual-pixel tile did
+            Magick::Image mask((tempPath + QString("/%1_%2_mask.tiff").arg(baseName, ch)).toStdString());
+            const int maskWidth = static_cast<int>(mask.columns());
+            const int maskHeight = static_cast<int>(mask.rows());
+            maskBytes[i].resize(static_cast<size_t>(maskWidth) * maskHeight);
+            mask.write(0, 0, maskWidth, maskHeight, "I", Magick::CharPixel, maskBytes[i].data());
+            masks[i] = { maskBytes[i].data(), maskWidth, maskHeight, 0, 0 };
+
+            int w = static_cast<int>(ditherImages[i].columns());
+            int h = static_cast<int>(ditherImages[i].rows());
+
+            if (i == 0) {
+                width = w;
+                height = h;
+            } else if (w != width || h != height) {
+                qWarning() << "Size mismatch across channels!";
+                return false;
+            }
+        }
 
-        int w = static_cast<int>(ditherImage.columns());
-        int h = static_cast<int>(ditherImage.rows());
+        stageTimer.countCopy();
+        stageTimer.lap("load");
 
-        if (i == 0) {
-            width = w;
-            height = h;
-        } else if (w != width || h != height) {
-            qWarning() << "Size mismatch across channels!";
+        // 4. Classify, promote, pack and write the PRN one band at a time
+        NocaiBandPipeline pipeline;
+        pipeline.setThreadPool(&screeningPool);
+        if (!pipeline.begin(QUrl(outputPath).toLocalFile(), width, height, xdpi, ydpi, masks))
             return false;
+
+        const int bandRows = NocaiBandPipeline::DefaultBandRows;
+        std::array<ImagePlane, 4> dithered;
+        for (ImagePlane& plane : dithered)
+            plane.reset(width, bandRows, 1);
+
+        for (int y0 = 0; y0 < height; y0 += bandRows) {
+            const int rows = std::min(bandRows, height - y0);
+
+            std::array<PlaneView, 4> ditheredRows;
+            for (int i = 0; i < 4; ++i) {
+                ditherImages[i].write(0, y0, width, rows, "I", Magick::CharPixel, dithered[i].data());
+                ditheredRows[i] = dithered[i].view().rows(0, rows);
+            }
+            stageTimer.lap("export");
+
+            pipeline.classifyBands(ditheredRows);
+            stageTimer.lap("classify");
+
+            if (!pipeline.commitBand())
+                return false;
+            stageTimer.lap("output");
         }
 
-        std::vector<uint8_t> dithered(width * height);
-        std::vector<uint8_t> maskBytes(width * height);
+        stageTimer.countCopy();     // Dithered export
+
+        const bool finished = pipeline.finish();
+        stageTimer.lap("output");
+        return finished;
+
+    } catch (const Magick::Exception& e) {
+        qWarning() << "❌ PRN generation failed:" << e.what();
+        return false;
+    }
+}
+
+
+// lcms input format for ScanlineReader's RGB16 rows under an input profile. Gray profiles
+// read the first sample of each pixel, since gray rows arrive as R = G = B; 0 for profiles
+// of any other colour space
+static cmsUInt32Number readerFormat(const QByteArray& icc) {
+    cmsHPROFILE profile = cmsOpenProfileFromMem(icc.constData(), static_cast<cmsUInt32Number>(icc.size()));
+    if (!profile)
+        return 0;
+    const cmsColorSpaceSignature space = cmsGetColorSpace(profile);
+    cmsCloseProfile(profile);
+
+    switch (space) {
+    case cmsSigRgbData:  return TYPE_RGB_16;
+    case cmsSigGrayData: return TYPE_GRAY_16 | EXTRA_SH(2);
+    default:             return 0;
+    }
+}
+
+
+/*
+    Native equivalent of cmyk_dither_mask.sh + the PRN packing stage.
+    Mirrors the script step for step in memory, a band of rows at a time:
+        1. ICC conversion (embedded profile ->) sRGB -> printer CMYK
+        2. Channel separation
+        3. Rolled, tiled blue noise mask per channel and `u>=v` thresholding
+        4. Dot classification, 4x4 promotion, 2BPP packing, PRN write
+    TIFF, PNG and JPEG inputs are decoded a band at a time by ScanlineReader,
+    so nothing is held at full size; other formats fall back to a whole-image
+    ImageMagick decode. See NocaiBandPipeline.
+    The transform runs at 16 bits with ImageMagick's flags and quantum scaling
+    so the separations match what the bundled magick binary writes to TIFF.
+*/
+bool PrintJobNocai::generatePRNNative(const QString& imagePath, const QString& outputPath, int xdpi, int ydpi) {
+    if (assetsExtractPath.isEmpty())
+        prepareNocaiAssets();
+
+    QUrl imageUrl(imagePath);
+    const QString localImage = imageUrl.isLocalFile() ? imageUrl.toLocalFile() : imagePath;
+
+    stageTimer.clear();
+    stageTimer.restart();
+
+    // 1. Open a row reader; streaming backends keep only a band of the input in memory
+    std::unique_ptr<ScanlineReader> reader = ScanlineReader::open(localImage);
+    if (!reader)
+        return false;
+
+    const int width = reader->width();
+    const int height = reader->height();
+    if (reader->holdsWholeImage())
+        stageTimer.countCopy();     // ImageMagick fallback decodes the page up front
+    stageTimer.lap("open");
+
+    // 2. ICC transforms, as the script's `-profile sRGB -profile <printer>`: sRGB is assigned
+    //    to untagged input, while an embedded profile (RGB or gray) is converted to sRGB first
+    TransformCache& transforms = TransformCache::instance();
+    const QByteArray srgbICC = transforms.profileData(assetsExtractPath + "/sRGBProfile.icm");
+    const QByteArray outputICC = transforms.profileData(assetsExtractPath + "/RIP_App_Plain_Paper.icm");
+
+    if (srgbICC.isEmpty() || outputICC.isEmpty()) {
+        qWarning() << "❌ Failed to load one or both ICC profiles.";
+        return false;
+    }
+
+    // Cached and built without the 1-pixel cache, so the worker threads below can share them
+    TransformCache::Transform toSRGB;
+    const QByteArray& embeddedICC = reader->iccProfile();
+    if (!embeddedICC.isEmpty() && embeddedICC != srgbICC) {
+        const cmsUInt32Number inputFormat = readerFormat(embeddedICC);
+        if (inputFormat)
+            toSRGB = transforms.transform(embeddedICC, inputFormat, srgbICC, TYPE_RGB_16,
+                                          INTENT_PERCEPTUAL, cmsFLAGS_HIGHRESPRECALC);
+        if (!toSRGB)
+            qWarning() << "⚠️ Embedded ICC profile not usable for" << localImage << "- assuming sRGB";
+    }
+
+    const TransformCache::Transform transform = transforms.transform(srgbICC, TYPE_RGB_16,
+                                                                     outputICC, TYPE_CMYK_16,
+                                                                     INTENT_PERCEPTUAL, cmsFLAGS_HIGHRESPRECALC);
+    if (!transform)
+        return false;
+
+    // 3. Rolled blue noise mask tile per channel
+    std::array<MaskTile, 4> masks;
+    if (!MaskCache::channelTiles(512, masks))
+        return false;
+
+    NocaiBandPipeline pipeline;
+    pipeline.setThreadPool(&screeningPool);
+    if (!pipeline.begin(QUrl(outputPath).toLocalFile(), width, height, xdpi, ydpi, masks))
+        return false;
+
+    // 4. Convert, separate, screen and write one band at a time
+    const int bandRows = NocaiBandPipeline::DefaultBandRows;
+    const size_t bandCapacity = static_cast<size_t>(width) * bandRows;
+    std::vector<uint16_t> rgb16(bandCapacity * 3);
+    std::vector<uint16_t> cmyk16(bandCapacity * 4);
+    std::array<ImagePlane, 4> ink;
+    for (ImagePlane& plane : ink)
+        plane.reset(width, bandRows);
+
+    stageTimer.lap("setup");
+
+    bool ok = true;
+    for (int y0 = 0; y0 < height && ok; y0 += bandRows) {
+        const int rows = std::min(bandRows, height - y0);
+
+        if (!reader->readRows(rgb16.data(), rows)) {
+            ok = false;
+            break;
+        }
+        stageTimer.lap("decode");
+
+        // Transform and separate row chunks in parallel
+        parallelFor(&screeningPool, rows, [&](int begin, int end) {
+            const size_t first = static_cast<size_t>(begin) * width;
+            const cmsUInt32Number pixels = static_cast<cmsUInt32Number>(static_cast<size_t>(end - begin) * width);
+            if (toSRGB)     // In place: both formats are three 16-bit samples per pixel
+                cmsDoTransform(toSRGB.get(), rgb16.data() + first * 3, rgb16.data() + first * 3, pixels);
+            cmsDoTransform(transform.get(), rgb16.data() + first * 3, cmyk16.data() + first * 4, pixels);
+
+            // Quantum -> char scaling used by ImageMagick Q16 when writing 8-bit TIFF
+            for (int r = begin; r < end; ++r) {
+                const uint16_t* src = cmyk16.data() + static_cast<size_t>(r) * width * 4;
+                for (int ch = 0; ch < 4; ++ch) {
+                    uint8_t* dst = ink[ch].row(r);
+                    for (int x = 0; x < width; ++x) {
+                        const uint32_t q = src[x * 4 + ch];
+                        dst[x] = static_cast<uint8_t>(((q + 128u) - ((q + 128u) >> 8)) >> 8);
+                    }
+                }
+            }
+        }, NocaiBandPipeline::MinRowsPerTask);
+        stageTimer.lap("icc");
 
-        ditherImage.write(0, 0, width, height, "I", Magick::CharPixel, dithered.data());
-        maskImage.write(0, 0, width, height, "I", Magick::CharPixel, maskBytes.data());
+        pipeline.screenBands({ ink[0].view().rows(0, rows), ink[1].view().rows(0, rows),
+                               ink[2].view().rows(0, rows), ink[3].view().rows(0, rows) });
+        stageTimer.lap("screen");
 
-        auto dotMap = dotClassification(dithered, maskBytes, width, height);
-        apply4x4Promotion(dotMap, width, height);
-        packedLines[i] = packTo2BPP(dotMap, width, height);
+        ok = pipeline.commitBand();
+        stageTimer.lap("output");
     }
+    stageTimer.countCopy();     // Decode into the RGB bands
+    stageTimer.countCopy();     // Transform and separation into the ink bands
 
-    // 4. Write final PRN file
-    std::vector<int> nocaiOrder = { 2, 1, 0, 3 };  // Y M C K
-    return writePRNFile(std::vector<std::vector<std::vector<uint8_t>>>(packedLines.begin(), packedLines.end()),
-                        nocaiOrder, width, height, xdpi, ydpi, outputPath);
+    ok = ok && pipeline.finish();
+    stageTimer.lap("output");
+    return ok;
 }
 
 
@@ -652,8 +665,7 @@ void PrintJobNocai::cleanupTemporaryFiles(const QString& baseName, const QString
     QStringList suffixes = {
         "_c_1bit.tiff", "_m_1bit.tiff", "_y_1bit.tiff", "_k_1bit.tiff",
         "_c.tiff", "_m.tiff", "_y.tiff", "_k.tiff",
-        "_cmyk.tiff",
-        "_c_mask.tiff", "_m_mask.tiff", "_y_mask.tiff", "_k_mask.tiff"
+        "_cmyk.tiff"
     };
 
     for (const QString& suffix : suffixes) {
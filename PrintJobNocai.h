@@ -4,8 +4,15 @@
 #include <QStandardPaths>
 #include <QtConcurrent>
 #include <QTemporaryDir>
+#include <QThreadPool>
 #include <array>
 #include <Magick++.h>
+#include "ImagePlane.h"
+#include "ScanlineReader.h"
+#include "StageTimer.h"
+#include "TransformCache.h"
+
+class ColorLUT;
 
 
 class PrintJobNocai : public QObject {
@@ -24,6 +31,15 @@ public:
     Q_INVOKABLE bool applyICCConversion(const QString& inputProfile, const QString& outputProfile);
     Q_INVOKABLE bool generateFinalPRN(const QString& outputPath, int xdpi, int ydpi);
 
+    // Native in-process screening pipeline (default for runPRNGeneration)
+    Q_INVOKABLE bool generatePRNNative(const QString& imagePath, const QString& outputPath, int xdpi, int ydpi);
+    Q_INVOKABLE void setUseScriptPipeline(bool enabled) { useScriptPipeline = enabled; }
+    Q_INVOKABLE void setWorkerCount(int count);                 // Screening threads, <= 0 = one per core
+    Q_INVOKABLE int workerCount() const { return screeningPool.maxThreadCount(); }
+    Q_INVOKABLE void setClutTolerance(double deltaE) { clutMaxDeltaE = deltaE; }   // dE00 vs lcms2, <= 0 = always lcms2
+    const StageTimer& stageTimings() const { return stageTimer; }      // Per-stage wall time and copies of the last PRN run
+    Q_INVOKABLE int pageCopyCount() const { return stageTimer.copies(); }
+
     // Temp Pipeline for PRN script
     Q_INVOKABLE bool generatePRNviaScript(const QString& imagePath, const QString& outputPath, int xdpi, int ydpi);
     Q_INVOKABLE void prepareNocaiAssets();
@@ -33,28 +49,28 @@ public:
 private:
 
     // Internal images and data
-    Magick::Image inputImage;                        // RGB input (temporary copy)
-    Magick::Image cmykImage;                         // CMYK converted image
-    std::array<Magick::Image, 4> cmykChannels;       // C, M, Y, K separated
+    std::unique_ptr<ScanlineReader> inputReader;     // Rows of the loaded input, streamed by generateFinalPRN
+    QString inputPath;
+    std::shared_ptr<const ColorLUT> inputLUT;        // Conversion from applyICCConversion: the baked LUT,
+    TransformCache::Transform inputTransform;        // or the lcms2 transform when no LUT is within tolerance
     std::array<Magick::Image, 4> thresholdMasks;     // Blue noise masks per channel
     std::array<std::vector<uint8_t>, 4> dotMaps;     // Dot size maps per channel
     std::array<std::vector<uint8_t>, 4> packedOutput;// 2BPP output per channel
-    std::array<Magick::Image, 4> separateCMYK(Magick::Image& cmyk);
     Magick::Image buildDitherMask(const Magick::Image& baseMask, int width, int height, int offsetX, int offsetY);
 
-    // Paths and temp handling
+    // Input file name of the last loadInputImage
     QString originalFilename;
-    QString tempImagePath;
-    std::unique_ptr<QTemporaryDir> tempDir;
 
     // Internal helpers
     Magick::Blob loadICCProfile(const QString& filePath);    
 
+    // Native screening helpers
+    bool useScriptPipeline = false;
+    QThreadPool screeningPool;                               // Shared by channels and row bands
+    double clutMaxDeltaE = 1.0;                              // ColorLUT tolerance for applyICCConversion
+    StageTimer stageTimer;
+
     // Temp Pipeline for PRN Script
     QString assetsExtractPath;
-    std::vector<std::vector<uint8_t>> dotClassification(const std::vector<uint8_t>& dithered, const std::vector<uint8_t>& mask, int width, int height);
-    void apply4x4Promotion(std::vector<std::vector<uint8_t>>& dotMap, int width, int height);
-    std::vector<std::vector<uint8_t>> packTo2BPP(const std::vector<std::vector<uint8_t>>& dotMap, int width, int height);
-    bool writePRNFile(const std::vector<std::vector<std::vector<uint8_t>>>& packedLines, const std::vector<int>& channelOrder, int width, int height, int xdpi, int ydpi, const QString& outputPath);
 
 };
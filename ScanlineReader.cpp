@@ -0,0 +1,492 @@
+#include "ScanlineReader.h"
+#include <Magick++.h>
+#include <QDebug>
+#include <QFile>
+#include <QtGlobal>
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+
+#ifdef RIP_HAVE_LIBTIFF
+#include <tiffio.h>
+#endif
+#ifdef RIP_HAVE_LIBPNG
+#include <png.h>
+#endif
+#ifdef RIP_HAVE_LIBJPEG
+#include <jpeglib.h>
+#endif
+
+
+bool ScanlineReader::readRows(uint16_t* rgb, int rows) {
+    if (rows < 0 || m_nextRow + rows > m_height)
+        return false;
+    if (rows == 0)
+        return true;
+    if (!decodeRows(rgb, rows))
+        return false;
+    m_nextRow += rows;
+    return true;
+}
+
+
+bool ScanlineReader::readRows(uint8_t* rgb, int rows) {
+    m_scratch.resize(static_cast<size_t>(m_width) * 3 * std::max(rows, 0));
+    if (!readRows(m_scratch.data(), rows))
+        return false;
+
+    // Quantum -> char scaling of ImageMagick Q16
+    for (size_t i = 0; i < m_scratch.size(); ++i) {
+        const uint32_t q = m_scratch[i];
+        rgb[i] = static_cast<uint8_t>(((q + 128u) - ((q + 128u) >> 8)) >> 8);
+    }
+    return true;
+}
+
+
+void ScanlineReader::expandRow(const void* src, int width, int bitsPerSample, int samplesPerPixel,
+                               bool gray, bool minIsWhite, uint16_t* rgb) {
+    const uint8_t* src8 = static_cast<const uint8_t*>(src);
+    const uint16_t* src16 = static_cast<const uint16_t*>(src);
+
+    // 8-bit samples widen by 257, as ImageMagick scales them to Q16
+    auto sample = [&](size_t i) -> uint16_t {
+        return bitsPerSample == 16 ? src16[i] : static_cast<uint16_t>(src8[i] * 257);
+    };
+
+    for (int x = 0; x < width; ++x, rgb += 3) {
+        const size_t i = static_cast<size_t>(x) * samplesPerPixel;
+        if (gray) {
+            const uint16_t v = minIsWhite ? static_cast<uint16_t>(65535 - sample(i)) : sample(i);
+            rgb[0] = rgb[1] = rgb[2] = v;
+        } else {
+            rgb[0] = sample(i);
+            rgb[1] = sample(i + 1);
+            rgb[2] = sample(i + 2);
+        }
+    }
+}
+
+
+namespace {
+
+// === TIFF ===
+
+#ifdef RIP_HAVE_LIBTIFF
+
+class TiffReader : public ScanlineReader {
+public:
+    ~TiffReader() override {
+        if (m_tiff) TIFFClose(m_tiff);
+    }
+
+    // Contiguous 8/16-bit RGB or grayscale only; everything else goes to ImageMagick
+    bool open(const QString& localPath) {
+        m_backend = "libtiff";
+        m_tiff = TIFFOpen(QFile::encodeName(localPath).constData(), "r");
+        if (!m_tiff)
+            return false;
+
+        uint32_t width = 0, height = 0;
+        uint16_t photometric = 0, planar = PLANARCONFIG_CONTIG, format = SAMPLEFORMAT_UINT;
+        if (!TIFFGetField(m_tiff, TIFFTAG_IMAGEWIDTH, &width) || !TIFFGetField(m_tiff, TIFFTAG_IMAGELENGTH, &height)
+            || !TIFFGetField(m_tiff, TIFFTAG_PHOTOMETRIC, &photometric))
+            return false;
+        TIFFGetFieldDefaulted(m_tiff, TIFFTAG_BITSPERSAMPLE, &m_bits);
+        TIFFGetFieldDefaulted(m_tiff, TIFFTAG_SAMPLESPERPIXEL, &m_samples);
+        TIFFGetFieldDefaulted(m_tiff, TIFFTAG_PLANARCONFIG, &planar);
+        TIFFGetFieldDefaulted(m_tiff, TIFFTAG_SAMPLEFORMAT, &format);
+
+        m_gray = photometric == PHOTOMETRIC_MINISBLACK || photometric == PHOTOMETRIC_MINISWHITE;
+        m_minIsWhite = photometric == PHOTOMETRIC_MINISWHITE;
+
+        const bool supported = planar == PLANARCONFIG_CONTIG && format == SAMPLEFORMAT_UINT
+            && (m_bits == 8 || m_bits == 16)
+            && ((photometric == PHOTOMETRIC_RGB && m_samples >= 3) || (m_gray && m_samples >= 1));
+        if (!supported || width == 0 || height == 0 || width > INT32_MAX / 3 || height > INT32_MAX)
+            return false;
+
+        m_width = static_cast<int>(width);
+        m_height = static_cast<int>(height);
+
+        uint32_t iccSize = 0;
+        void* iccData = nullptr;
+        if (TIFFGetField(m_tiff, TIFFTAG_ICCPROFILE, &iccSize, &iccData) && iccData && iccSize > 0)
+            m_iccProfile = QByteArray(static_cast<const char*>(iccData), static_cast<qsizetype>(iccSize));
+
+        const size_t pixelBytes = static_cast<size_t>(m_samples) * m_bits / 8;
+
+        if (TIFFIsTiled(m_tiff)) {
+            if (!TIFFGetField(m_tiff, TIFFTAG_TILEWIDTH, &m_tileWidth) || !TIFFGetField(m_tiff, TIFFTAG_TILELENGTH, &m_tileHeight)
+                || m_tileWidth == 0 || m_tileHeight == 0)
+                return false;
+
+            // One full row of tiles; memory is width * tile height, whatever the image height
+            const size_t tilesAcross = (width + m_tileWidth - 1) / m_tileWidth;
+            m_rowStride = tilesAcross * m_tileWidth * pixelBytes;
+            m_tile.resize(static_cast<size_t>(TIFFTileSize(m_tiff)));
+            m_rows.resize(m_rowStride * m_tileHeight);
+        } else {
+            m_rowStride = static_cast<size_t>(TIFFScanlineSize(m_tiff));
+            m_rows.resize(std::max(m_rowStride, static_cast<size_t>(width) * pixelBytes));
+        }
+        return true;
+    }
+
+protected:
+    bool decodeRows(uint16_t* rgb, int rows) override {
+        for (int r = 0; r < rows; ++r, rgb += static_cast<size_t>(m_width) * 3) {
+            const uint32_t y = static_cast<uint32_t>(nextRow() + r);
+            const uint8_t* src = nullptr;
+
+            if (m_tileHeight > 0) {
+                const int tileRow = static_cast<int>(y / m_tileHeight);
+                if (tileRow != m_bufferedTileRow && !loadTileRow(tileRow))
+                    return false;
+                src = m_rows.data() + (y % m_tileHeight) * m_rowStride;
+            } else {
+                if (TIFFReadScanline(m_tiff, m_rows.data(), y, 0) < 0)
+                    return false;
+                src = m_rows.data();
+            }
+
+            expandRow(src, m_width, m_bits, m_samples, m_gray, m_minIsWhite, rgb);
+        }
+        return true;
+    }
+
+private:
+    TIFF* m_tiff = nullptr;
+    uint16_t m_bits = 1;
+    uint16_t m_samples = 1;
+    bool m_gray = false;
+    bool m_minIsWhite = false;
+
+    uint32_t m_tileWidth = 0;
+    uint32_t m_tileHeight = 0;          // 0 for stripped files
+    int m_bufferedTileRow = -1;
+    size_t m_rowStride = 0;
+    std::vector<uint8_t> m_tile;
+    std::vector<uint8_t> m_rows;        // One scanline, or one row of tiles laid out as scanlines
+
+    bool loadTileRow(int tileRow) {
+        const size_t tileRowBytes = static_cast<size_t>(m_tileWidth) * m_samples * m_bits / 8;
+        const uint32_t y0 = static_cast<uint32_t>(tileRow) * m_tileHeight;
+
+        for (uint32_t x0 = 0, column = 0; x0 < static_cast<uint32_t>(m_width); x0 += m_tileWidth, ++column) {
+            if (TIFFReadTile(m_tiff, m_tile.data(), x0, y0, 0, 0) < 0)
+                return false;
+            for (uint32_t ty = 0; ty < m_tileHeight; ++ty)
+                std::memcpy(m_rows.data() + ty * m_rowStride + column * tileRowBytes, m_tile.data() + ty * tileRowBytes, tileRowBytes);
+        }
+
+        m_bufferedTileRow = tileRow;
+        return true;
+    }
+};
+
+#endif
+
+
+// === PNG ===
+
+#ifdef RIP_HAVE_LIBPNG
+
+void pngError(png_structp png, png_const_charp message) {
+    qWarning() << "libpng:" << message;
+    png_longjmp(png, 1);
+}
+
+void pngWarning(png_structp, png_const_charp) {}
+
+class PngReader : public ScanlineReader {
+public:
+    ~PngReader() override {
+        if (m_png) png_destroy_read_struct(&m_png, m_info ? &m_info : nullptr, nullptr);
+        if (m_file) std::fclose(m_file);
+    }
+
+    // Interlaced files need every pass before the first row is final, so they go to ImageMagick
+    bool open(const QString& localPath) {
+        m_backend = "libpng";
+        m_file = std::fopen(QFile::encodeName(localPath).constData(), "rb");
+        if (!m_file)
+            return false;
+
+        png_byte signature[8];
+        if (std::fread(signature, 1, sizeof(signature), m_file) != sizeof(signature) || png_sig_cmp(signature, 0, sizeof(signature)))
+            return false;
+
+        m_png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, pngError, pngWarning);
+        m_info = m_png ? png_create_info_struct(m_png) : nullptr;
+        if (!m_info)
+            return false;
+
+        if (setjmp(png_jmpbuf(m_png)))
+            return false;
+
+        png_init_io(m_png, m_file);
+        png_set_sig_bytes(m_png, sizeof(signature));
+        png_read_info(m_png, m_info);
+
+        const int colorType = png_get_color_type(m_png, m_info);
+        const int bitDepth = png_get_bit_depth(m_png, m_info);
+        if (png_get_interlace_type(m_png, m_info) != PNG_INTERLACE_NONE)
+            return false;
+
+        png_charp name = nullptr;
+        int compression = 0;
+        png_bytep profile = nullptr;
+        png_uint_32 profileSize = 0;
+        if (png_get_iCCP(m_png, m_info, &name, &compression, &profile, &profileSize) && profile && profileSize > 0)
+            m_iccProfile = QByteArray(reinterpret_cast<const char*>(profile), static_cast<qsizetype>(profileSize));
+
+        // Everything to 8- or 16-bit RGB without alpha, samples in native byte order
+        if (colorType == PNG_COLOR_TYPE_PALETTE)
+            png_set_palette_to_rgb(m_png);
+        if (colorType == PNG_COLOR_TYPE_GRAY && bitDepth < 8)
+            png_set_expand_gray_1_2_4_to_8(m_png);
+        if (colorType & PNG_COLOR_MASK_ALPHA)
+            png_set_strip_alpha(m_png);
+        if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+            png_set_gray_to_rgb(m_png);
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        if (bitDepth == 16)
+            png_set_swap(m_png);
+#endif
+        png_read_update_info(m_png, m_info);
+
+        m_width = static_cast<int>(png_get_image_width(m_png, m_info));
+        m_height = static_cast<int>(png_get_image_height(m_png, m_info));
+        m_bits = png_get_bit_depth(m_png, m_info);
+
+        const size_t rowBytes = png_get_rowbytes(m_png, m_info);
+        if (rowBytes != static_cast<size_t>(m_width) * 3 * (m_bits / 8))
+            return false;
+        m_row.resize(rowBytes);
+        return m_width > 0 && m_height > 0;
+    }
+
+protected:
+    bool decodeRows(uint16_t* rgb, int rows) override {
+        if (setjmp(png_jmpbuf(m_png)))
+            return false;
+
+        for (int r = 0; r < rows; ++r) {
+            png_read_row(m_png, m_row.data(), nullptr);
+            expandRow(m_row.data(), m_width, m_bits, 3, false, false, rgb + static_cast<size_t>(r) * m_width * 3);
+        }
+        return true;
+    }
+
+private:
+    std::FILE* m_file = nullptr;
+    png_structp m_png = nullptr;
+    png_infop m_info = nullptr;
+    int m_bits = 8;
+    std::vector<uint8_t> m_row;
+};
+
+#endif
+
+
+// === JPEG ===
+
+#ifdef RIP_HAVE_LIBJPEG
+
+struct JpegError {
+    jpeg_error_mgr manager;
+    std::jmp_buf jump;
+};
+
+void jpegErrorExit(j_common_ptr info) {
+    char message[JMSG_LENGTH_MAX];
+    (*info->err->format_message)(info, message);
+    qWarning() << "libjpeg:" << message;
+    std::longjmp(reinterpret_cast<JpegError*>(info->err)->jump, 1);
+}
+
+class JpegReader : public ScanlineReader {
+public:
+    ~JpegReader() override {
+        if (m_created) jpeg_destroy_decompress(&m_info);
+        if (m_file) std::fclose(m_file);
+    }
+
+    // CMYK and YCCK files go to ImageMagick, which converts them to sRGB
+    bool open(const QString& localPath) {
+        m_backend = "libjpeg";
+        m_file = std::fopen(QFile::encodeName(localPath).constData(), "rb");
+        if (!m_file)
+            return false;
+
+        m_info.err = jpeg_std_error(&m_error.manager);
+        m_error.manager.error_exit = jpegErrorExit;
+        if (setjmp(m_error.jump))
+            return false;
+
+        jpeg_create_decompress(&m_info);
+        m_created = true;
+        jpeg_stdio_src(&m_info, m_file);
+        jpeg_save_markers(&m_info, JPEG_APP0 + 2, 0xFFFF);
+        jpeg_read_header(&m_info, TRUE);
+
+        if (m_info.jpeg_color_space == JCS_CMYK || m_info.jpeg_color_space == JCS_YCCK)
+            return false;
+
+        m_iccProfile = iccFromMarkers();
+
+        // Same decoder settings as ImageMagick's JPEG reader
+        m_info.out_color_space = JCS_RGB;
+        m_info.dct_method = JDCT_FLOAT;
+        jpeg_start_decompress(&m_info);
+
+        m_width = static_cast<int>(m_info.output_width);
+        m_height = static_cast<int>(m_info.output_height);
+        m_row.resize(static_cast<size_t>(m_width) * 3);
+        return m_width > 0 && m_height > 0 && m_info.output_components == 3;
+    }
+
+protected:
+    bool decodeRows(uint16_t* rgb, int rows) override {
+        if (setjmp(m_error.jump))
+            return false;
+
+        for (int r = 0; r < rows; ++r) {
+            JSAMPROW row = m_row.data();
+            if (jpeg_read_scanlines(&m_info, &row, 1) != 1)
+                return false;
+            expandRow(m_row.data(), m_width, 8, 3, false, false, rgb + static_cast<size_t>(r) * m_width * 3);
+        }
+        return true;
+    }
+
+private:
+    std::FILE* m_file = nullptr;
+    jpeg_decompress_struct m_info {};
+    JpegError m_error {};
+    bool m_created = false;
+    std::vector<JSAMPLE> m_row;
+
+    // ICC_PROFILE APP2 chunks, in sequence order; empty if any chunk is missing
+    QByteArray iccFromMarkers() const {
+        static const char Tag[] = "ICC_PROFILE";
+        std::vector<QByteArray> chunks;
+
+        for (jpeg_saved_marker_ptr marker = m_info.marker_list; marker; marker = marker->next) {
+            if (marker->marker != JPEG_APP0 + 2 || marker->data_length <= 14 || std::memcmp(marker->data, Tag, sizeof(Tag)) != 0)
+                continue;
+            const int sequence = marker->data[12];
+            const int count = marker->data[13];
+            if (sequence < 1 || sequence > count)
+                continue;
+            chunks.resize(count);
+            chunks[sequence - 1] = QByteArray(reinterpret_cast<const char*>(marker->data + 14), static_cast<qsizetype>(marker->data_length - 14));
+        }
+
+        QByteArray profile;
+        for (const QByteArray& chunk : chunks) {
+            if (chunk.isEmpty())
+                return QByteArray();
+            profile += chunk;
+        }
+        return profile;
+    }
+};
+
+#endif
+
+
+// === ImageMagick fallback: decodes everything up front ===
+
+class MagickReader : public ScanlineReader {
+public:
+    bool open(const QString& localPath) {
+        m_backend = "ImageMagick";
+        try {
+            m_image.read(localPath.toStdString());
+
+            Magick::Blob embedded = m_image.iccColorProfile();
+            if (m_image.colorSpace() == Magick::CMYKColorspace) {
+                m_image.colorSpace(Magick::sRGBColorspace);
+                embedded = Magick::Blob();          // A CMYK profile no longer describes the pixels
+            }
+            if (embedded.length() > 0)
+                m_iccProfile = QByteArray(static_cast<const char*>(embedded.data()), static_cast<qsizetype>(embedded.length()));
+
+            m_width = static_cast<int>(m_image.columns());
+            m_height = static_cast<int>(m_image.rows());
+            return m_width > 0 && m_height > 0;
+        } catch (const Magick::Exception& e) {
+            qWarning() << "Image load failed:" << e.what();
+            return false;
+        }
+    }
+
+    bool holdsWholeImage() const override { return true; }
+
+protected:
+    bool decodeRows(uint16_t* rgb, int rows) override {
+        try {
+            m_image.write(0, nextRow(), m_width, rows, "RGB", Magick::ShortPixel, rgb);
+            return true;
+        } catch (const Magick::Exception& e) {
+            qWarning() << "Image export failed:" << e.what();
+            return false;
+        }
+    }
+
+private:
+    Magick::Image m_image;
+};
+
+
+template <typename Reader>
+std::unique_ptr<ScanlineReader> tryOpen(const QString& localPath) {
+    auto reader = std::make_unique<Reader>();
+    if (reader->open(localPath))
+        return reader;
+    qDebug() << reader->backendName() << "cannot stream" << localPath << "- falling back to ImageMagick";
+    return nullptr;
+}
+
+}
+
+
+std::unique_ptr<ScanlineReader> ScanlineReader::open(const QString& localPath) {
+    QFile file(localPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot open image:" << localPath;
+        return nullptr;
+    }
+    const QByteArray magic = file.read(8);
+    file.close();
+
+    std::unique_ptr<ScanlineReader> reader;
+
+#ifdef RIP_HAVE_LIBTIFF
+    if (magic.startsWith(QByteArray("II*\0", 4)) || magic.startsWith(QByteArray("MM\0*", 4))
+        || magic.startsWith(QByteArray("II+\0", 4)) || magic.startsWith(QByteArray("MM\0+", 4)))
+        reader = tryOpen<TiffReader>(localPath);
+#endif
+#ifdef RIP_HAVE_LIBPNG
+    if (magic.startsWith("\x89PNG"))
+        reader = tryOpen<PngReader>(localPath);
+#endif
+#ifdef RIP_HAVE_LIBJPEG
+    if (magic.startsWith("\xFF\xD8\xFF"))
+        reader = tryOpen<JpegReader>(localPath);
+#endif
+
+    if (!reader) {
+        auto fallback = std::make_unique<MagickReader>();
+        if (fallback->open(localPath))
+            reader = std::move(fallback);
+    }
+
+    if (reader)
+        qDebug() << "Reading" << localPath << "with" << reader->backendName()
+                 << QString("(%1x%2)").arg(reader->width()).arg(reader->height());
+    return reader;
+}
@@ -0,0 +1,62 @@
+// ScanlineReader.h
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+/*******************************************************************************************
+    ScanlineReader decodes an image top to bottom a few rows at a time, so the RIP can
+    stream inputs far larger than memory through its band pipeline.
+
+        TIFF    strips via TIFFReadScanline, tiles one tile row at a time (libtiff)
+        PNG     non-interlaced, row by row (libpng)
+        JPEG    scanline by scanline (libjpeg)
+
+    Anything a streaming backend cannot take (interlaced PNG, CMYK, palette TIFF, other
+    formats, or a build without the library) falls back to ImageMagick, which decodes the
+    whole image first. Rows come out as interleaved 16-bit RGB with the values ImageMagick
+    Q16 would export, so either backend feeds the native pipeline identically.
+
+    Usage:
+        auto reader = ScanlineReader::open(localPath);
+        while (reader->nextRow() < reader->height()) reader->readRows(buffer, rows);
+********************************************************************************************/
+
+class ScanlineReader {
+public:
+    virtual ~ScanlineReader() = default;
+
+    // Best backend for the file, or null (with a warning) if nothing can read it
+    static std::unique_ptr<ScanlineReader> open(const QString& localPath);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    int nextRow() const { return m_nextRow; }
+    const QByteArray& iccProfile() const { return m_iccProfile; }       // Embedded profile, empty if none
+    const char* backendName() const { return m_backend; }
+    virtual bool holdsWholeImage() const { return false; }              // True for the ImageMagick fallback
+
+    // The next `rows` rows as RGB, width * 3 samples per row; false on a decode error
+    bool readRows(uint16_t* rgb, int rows);
+    bool readRows(uint8_t* rgb, int rows);                              // Scaled as ImageMagick's CharPixel
+
+protected:
+    int m_width = 0;
+    int m_height = 0;
+    QByteArray m_iccProfile;
+    const char* m_backend = "";
+
+    virtual bool decodeRows(uint16_t* rgb, int rows) = 0;
+
+    // Expand one decoded row of 8- or 16-bit samples (native endian) to RGB16; extra samples are dropped
+    static void expandRow(const void* src, int width, int bitsPerSample, int samplesPerPixel,
+                          bool gray, bool minIsWhite, uint16_t* rgb);
+
+private:
+    int m_nextRow = 0;
+    std::vector<uint16_t> m_scratch;
+};
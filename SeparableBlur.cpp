@@ -0,0 +1,449 @@
+#include "SeparableBlur.h"
+#include "ParallelFor.h"
+#include "PixelView.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SEPARABLE_BLUR_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace Magick;
+
+
+namespace SeparableBlur {
+
+// === 1-D pass ===
+// Every version sums taps in the same order with separate multiply and add, so their
+// results are identical.
+
+static void convolveScalar(const float* src, ptrdiff_t step, const float* taps, int tapCount, float* dst, int count) {
+    for (int i = 0; i < count; ++i) {
+        float sum = taps[0] * src[i];
+        for (int k = 1; k < tapCount; ++k)
+            sum = sum + taps[k] * src[k * step + i];
+        dst[i] = sum;
+    }
+}
+
+
+#ifdef SEPARABLE_BLUR_X86
+
+static void convolveSSE2(const float* src, ptrdiff_t step, const float* taps, int tapCount, float* dst, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 tap = _mm_set1_ps(taps[0]);
+        __m128 a = _mm_mul_ps(tap, _mm_loadu_ps(src + i));
+        __m128 b = _mm_mul_ps(tap, _mm_loadu_ps(src + i + 4));
+        for (int k = 1; k < tapCount; ++k) {
+            const float* row = src + k * step + i;
+            tap = _mm_set1_ps(taps[k]);
+            a = _mm_add_ps(a, _mm_mul_ps(tap, _mm_loadu_ps(row)));
+            b = _mm_add_ps(b, _mm_mul_ps(tap, _mm_loadu_ps(row + 4)));
+        }
+        _mm_storeu_ps(dst + i, a);
+        _mm_storeu_ps(dst + i + 4, b);
+    }
+    convolveScalar(src + i, step, taps, tapCount, dst + i, count - i);
+}
+
+
+__attribute__((target("avx2")))
+static void convolveAVX2(const float* src, ptrdiff_t step, const float* taps, int tapCount, float* dst, int count) {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256 tap = _mm256_set1_ps(taps[0]);
+        __m256 a = _mm256_mul_ps(tap, _mm256_loadu_ps(src + i));
+        __m256 b = _mm256_mul_ps(tap, _mm256_loadu_ps(src + i + 8));
+        for (int k = 1; k < tapCount; ++k) {
+            const float* row = src + k * step + i;
+            tap = _mm256_set1_ps(taps[k]);
+            a = _mm256_add_ps(a, _mm256_mul_ps(tap, _mm256_loadu_ps(row)));
+            b = _mm256_add_ps(b, _mm256_mul_ps(tap, _mm256_loadu_ps(row + 8)));
+        }
+        _mm256_storeu_ps(dst + i, a);
+        _mm256_storeu_ps(dst + i + 8, b);
+    }
+    convolveSSE2(src + i, step, taps, tapCount, dst + i, count - i);
+}
+
+#endif // SEPARABLE_BLUR_X86
+
+
+// === Dispatch ===
+
+static const Table scalarTable = { Isa::Scalar, convolveScalar };
+#ifdef SEPARABLE_BLUR_X86
+static const Table sse2Table = { Isa::SSE2, convolveSSE2 };
+static const Table avx2Table = { Isa::AVX2, convolveAVX2 };
+#endif
+
+
+const Table& forIsa(Isa isa) {
+#ifdef SEPARABLE_BLUR_X86
+    if (isa == Isa::AVX2 && __builtin_cpu_supports("avx2")) return avx2Table;
+    if (isa != Isa::Scalar && __builtin_cpu_supports("sse2")) return sse2Table;
+#else
+    (void) isa;
+#endif
+    return scalarTable;
+}
+
+
+const Table& active() {
+    static const Table& table = [] () -> const Table& {
+        const char* env = std::getenv("RIP_KERNELS");
+        if (env && std::strcmp(env, "scalar") == 0) return SeparableBlur::forIsa(Isa::Scalar);
+        if (env && std::strcmp(env, "sse2") == 0) return SeparableBlur::forIsa(Isa::SSE2);
+        return SeparableBlur::forIsa(Isa::AVX2);
+    }();
+    return table;
+}
+
+
+// === Kernels ===
+
+namespace {
+
+constexpr double Epsilon = 1.0e-12;             // MagickEpsilon
+constexpr double Pi = 3.141592653589793;        // MagickPI
+constexpr int KernelRank = 3;                   // BlurImage's supersampling of each tap
+
+double magickSigma(double sigma) {
+    return std::fabs(sigma) < Epsilon ? Epsilon : sigma;
+}
+
+
+// GetOptimalKernelWidth1D and 2D: widen until the outer taps fall below one quantum
+int optimalWidth(double radius, double sigma, bool twoDimensional) {
+    if (radius > Epsilon)
+        return 2 * static_cast<int>(std::ceil(radius)) + 1;
+    if (std::fabs(sigma) <= Epsilon)
+        return 3;
+
+    const double alpha = 1.0 / (2.0 * sigma * sigma);
+    const double beta = twoDimensional ? 1.0 / (2.0 * Pi * sigma * sigma) : 1.0 / (std::sqrt(2.0 * Pi) * sigma);
+    int width = 5;
+    for (;; width += 2) {
+        const int j = (width - 1) / 2;
+        double normalize = 0.0;
+        for (int v = -j; v <= j; ++v)
+            for (int u = twoDimensional ? -j : 0; u <= (twoDimensional ? j : 0); ++u)
+                normalize += std::exp(-(double(u) * u + double(v) * v) * alpha) * beta;
+        const double value = std::exp(-double(j) * j * alpha) * beta / normalize;
+        if (value < 1.0 / QuantumRange || value < Epsilon)
+            break;
+    }
+    return width - 2;
+}
+
+
+std::vector<float> normalised(const std::vector<double>& values) {
+    double sum = 0.0;
+    for (double value : values)
+        sum += value;
+
+    std::vector<float> taps(values.size());
+    for (size_t i = 0; i < values.size(); ++i)
+        taps[i] = static_cast<float>(values[i] / sum);
+    return taps;
+}
+
+
+// The channels tiles carry; images with alpha or in other colour spaces are left to ImageMagick
+bool filteredChannels(const Image& image, PixelView::Channels& channels) {
+    using namespace MagickCore;
+    if (image.alpha())
+        return false;
+
+    switch (image.colorSpace()) {
+    case sRGBColorspace:
+    case RGBColorspace:         channels = { RedPixelChannel, GreenPixelChannel, BluePixelChannel }; return true;
+    case GRAYColorspace:
+    case LinearGRAYColorspace:  channels = { GrayPixelChannel }; return true;
+    case CMYKColorspace:        channels = { CyanPixelChannel, MagentaPixelChannel, YellowPixelChannel, BlackPixelChannel };
+                                return true;
+    default:                    return false;
+    }
+}
+
+
+/*
+    Box of 2 radius + 1 positions, step floats apart, each holding `lanes` contiguous
+    values; a running sum makes it the same cost at any radius.
+*/
+void boxPass(const float* src, ptrdiff_t srcStep, float* dst, ptrdiff_t dstStep, int lanes, int count, int radius,
+             float* sum) {
+    const int width = 2 * radius + 1;
+    const float scale = 1.0f / width;
+
+    std::fill(sum, sum + lanes, 0.0f);
+    for (int k = 0; k < width; ++k) {
+        const float* in = src + k * srcStep;
+        for (int l = 0; l < lanes; ++l)
+            sum[l] += in[l];
+    }
+
+    for (int p = 0;; ++p) {
+        float* out = dst + p * dstStep;
+        for (int l = 0; l < lanes; ++l)
+            out[l] = sum[l] * scale;
+        if (p + 1 == count)
+            break;
+
+        const float* enter = src + (p + width) * srcStep;
+        const float* leave = src + p * srcStep;
+        for (int l = 0; l < lanes; ++l)
+            sum[l] += enter[l] - leave[l];
+    }
+}
+
+
+// A tile as it reaches a filter: `in` is (columns + 2 halo) x (rows + 2 halo) samples
+struct Tile {
+    const float* in;
+    int inColumns, inRows;
+    int columns, rows;
+    int channels;
+    std::vector<float>* scratch;        // Two buffers per thread, each at least the size of in
+    float* out;                         // columns x rows samples
+};
+
+
+void gaussianTile(const Tile& tile, const std::vector<float>& taps, const Table& kernels) {
+    const int inStride = tile.inColumns * tile.channels;
+    const int stride = tile.columns * tile.channels;
+    const int tapCount = static_cast<int>(taps.size());
+    float* across = tile.scratch[0].data();
+
+    for (int y = 0; y < tile.inRows; ++y)
+        kernels.convolve(tile.in + y * inStride, tile.channels, taps.data(), tapCount, across + y * stride, stride);
+    for (int y = 0; y < tile.rows; ++y)
+        kernels.convolve(across + y * stride, stride, taps.data(), tapCount, tile.out + y * stride, stride);
+}
+
+
+void boxTile(const Tile& tile, const std::vector<int>& radii) {
+    const int channels = tile.channels;
+    const int stride = tile.columns * channels;
+    float* across = tile.scratch[0].data();
+    float* down = tile.scratch[1].data();
+    std::vector<float> sum(stride);
+    std::vector<float> line[2] = { std::vector<float>(tile.inColumns * channels),
+                                   std::vector<float>(tile.inColumns * channels) };
+
+    // Across, one row at a time through two line buffers; each pass narrows by 2 radius
+    for (int y = 0; y < tile.inRows; ++y) {
+        const float* src = tile.in + y * tile.inColumns * channels;
+        int width = tile.inColumns;
+        for (size_t i = 0; i < radii.size(); ++i) {
+            width -= 2 * radii[i];
+            float* dst = i + 1 == radii.size() ? across + y * stride : line[i % 2].data();
+            boxPass(src, channels, dst, channels, channels, width, radii[i], sum.data());
+            src = dst;
+        }
+    }
+
+    // Down, all columns of a row at once
+    const float* src = across;
+    int height = tile.inRows;
+    for (size_t i = 0; i < radii.size(); ++i) {
+        height -= 2 * radii[i];
+        float* dst = i + 1 == radii.size() ? tile.out : (i % 2 ? across : down);
+        boxPass(src, stride, dst, stride, stride, height, radii[i], sum.data());
+        src = dst;
+    }
+}
+
+
+/*
+    Runs filter on every tile of image and replaces image with the result. Tiles read
+    from image and write into a copy, so their halos never see filtered pixels. Every
+    task transfers through cache views of its own (see PixelView).
+
+    Each finished tile is reported to image's progress monitor under tag, as BlurImage
+    reports rows; a monitor returning false aborts with image untouched.
+*/
+template <typename Filter>
+void filterTiles(Image& image, const char* tag, const PixelView::Channels& pixelChannels, int halo,
+                 QThreadPool* pool, Filter filter) {
+    const int channels = static_cast<int>(pixelChannels.size());
+    const int columns = static_cast<int>(image.columns());
+    const int rows = static_cast<int>(image.rows());
+    const int tileColumns = std::max(TileColumns, 4 * halo);
+    const int tileRows = std::max(TileRows, 4 * halo);
+    const int tilesAcross = (columns + tileColumns - 1) / tileColumns;
+    const int tilesDown = (rows + tileRows - 1) / tileRows;
+
+    // A copy of an Image shares its MagickCore image, so result has to be unshared
+    // before target can differ from source
+    const MagickCore::Image* source = image.constImage();
+    Image result = image;
+    result.modifyImage();
+    MagickCore::Image* target = result.image();
+
+    // Take result's own pixel cache now, rather than in whichever tile writes first
+    MagickCore::ExceptionInfo* exception = MagickCore::AcquireExceptionInfo();
+    const bool unshared = MagickCore::GetAuthenticPixels(target, 0, 0, 1, 1, exception) != nullptr;
+    MagickCore::DestroyExceptionInfo(exception);
+    if (!unshared)
+        throw ErrorCache("SeparableBlur: could not allocate result pixels");
+
+    const MagickCore::MagickProgressMonitor monitor = source->progress_monitor;
+    const MagickCore::MagickSizeType tiles = MagickCore::MagickSizeType(tilesAcross) * tilesDown;
+    std::atomic_int progress(0);
+    std::atomic_bool failed(false);
+    std::atomic_bool aborted(false);
+
+    parallelFor(pool, tilesAcross * tilesDown, [&](int begin, int end) {
+        const size_t inSize = size_t(std::min(tileColumns, columns) + 2 * halo)
+                              * size_t(std::min(tileRows, rows) + 2 * halo) * channels;
+        std::vector<float> in(inSize);
+        std::vector<float> scratch[2] = { std::vector<float>(inSize), std::vector<float>(inSize) };
+        std::vector<float> out(size_t(tileColumns) * tileRows * channels);
+        PixelView reader(source, false);
+        PixelView writer(target, true);
+
+        for (int t = begin; t < end && !failed && !aborted; ++t) {
+            Tile tile;
+            const int x = (t % tilesAcross) * tileColumns;
+            const int y = (t / tilesAcross) * tileRows;
+            tile.columns = std::min(tileColumns, columns - x);
+            tile.rows = std::min(tileRows, rows - y);
+            tile.inColumns = tile.columns + 2 * halo;
+            tile.inRows = tile.rows + 2 * halo;
+            tile.channels = channels;
+            tile.in = in.data();
+            tile.scratch = scratch;
+            tile.out = out.data();
+
+            // Outside the image the halo holds virtual pixels, as convolution reads them
+            if (!reader.read(x - halo, y - halo, tile.inColumns, tile.inRows, pixelChannels, in.data())) {
+                failed = true;
+                break;
+            }
+            filter(tile);
+            if (!writer.write(x, y, tile.columns, tile.rows, pixelChannels, out.data()))
+                failed = true;
+            else if (monitor && !monitor(tag, progress++, tiles, source->client_data))
+                aborted = true;
+        }
+    });
+
+    if (aborted)
+        throw ErrorMonitor("SeparableBlur: aborted by the progress monitor");
+    if (failed)
+        throw ErrorCache("SeparableBlur: could not transfer image pixels");
+    image = result;
+}
+
+}
+
+
+std::vector<float> blurTaps(double radius, double sigma) {
+    // BlurImage truncates a radius of 1 or more, and sizes the kernel itself below that
+    const int width = radius >= 1.0 ? 2 * static_cast<int>(radius) + 1 : optimalWidth(radius, sigma, false);
+    std::vector<double> values(width, 0.0);
+
+    if (std::fabs(sigma) > Epsilon) {
+        const double s = sigma * KernelRank;
+        const double alpha = 1.0 / (2.0 * s * s);
+        const int v = (width * KernelRank - 1) / 2;
+        for (int u = -v; u <= v; ++u)
+            values[(u + v) / KernelRank] += std::exp(-double(u) * u * alpha);
+    } else {
+        values[(width - 1) / 2] = 1.0;
+    }
+    return normalised(values);
+}
+
+
+std::vector<float> sharpenTaps(double radius, double sigma) {
+    const int width = optimalWidth(radius, sigma, true);
+    const int j = (width - 1) / 2;
+    const double s = magickSigma(sigma);
+
+    std::vector<double> values(width);
+    for (int u = -j; u <= j; ++u)
+        values[u + j] = std::exp(-double(u) * u / (2.0 * s * s));
+    return normalised(values);
+}
+
+
+// Kovesi's box sizes: odd widths w and w + 2, as many of each as brings the variance to sigma^2
+std::vector<int> boxRadii(double sigma) {
+    constexpr int Passes = 3;
+    const double variance = 12.0 * sigma * sigma;
+
+    int lower = static_cast<int>(std::floor(std::sqrt(variance / Passes + 1.0)));
+    if (lower % 2 == 0)
+        --lower;
+    const int upper = lower + 2;
+    const long narrow = std::lround((variance - Passes * lower * lower - 4.0 * Passes * lower - 3.0 * Passes)
+                                    / (-4.0 * lower - 4.0));
+
+    std::vector<int> radii;
+    for (int i = 0; i < Passes; ++i)
+        radii.push_back(((i < narrow ? lower : upper) - 1) / 2);
+    return radii;
+}
+
+
+bool blur(Image& image, double radius, double sigma, Mode mode, QThreadPool* pool, const Table& kernels) {
+    PixelView::Channels channels;
+    if (!filteredChannels(image, channels))
+        return false;
+
+    // An explicit radius clips the kernel, which boxes cannot reproduce
+    if (mode == Mode::Auto)
+        mode = radius < 1.0 && std::fabs(sigma) >= BoxSigmaThreshold ? Mode::Box : Mode::Gaussian;
+
+    if (mode == Mode::Box) {
+        const std::vector<int> radii = boxRadii(std::fabs(sigma));
+        int halo = 0;
+        for (int r : radii)
+            halo += r;
+        if (halo == 0)
+            return true;
+        filterTiles(image, "Blur/Image", channels, halo, pool, [&](const Tile& tile) { boxTile(tile, radii); });
+    } else {
+        const std::vector<float> taps = blurTaps(radius, sigma);
+        if (taps.size() == 1)
+            return true;
+        filterTiles(image, "Blur/Image", channels, static_cast<int>(taps.size() - 1) / 2, pool,
+                    [&](const Tile& tile) { gaussianTile(tile, taps, kernels); });
+    }
+    return true;
+}
+
+
+bool sharpen(Image& image, double radius, double sigma, QThreadPool* pool, const Table& kernels) {
+    PixelView::Channels channels;
+    if (!filteredChannels(image, channels))
+        return false;
+
+    const std::vector<float> taps = sharpenTaps(radius, sigma);
+    const int halo = static_cast<int>(taps.size() - 1) / 2;
+    const double centre = double(taps[halo]) * taps[halo];
+    const float gain = static_cast<float>(2.0 + centre);
+    const float scale = static_cast<float>(1.0 / (1.0 + centre));
+
+    filterTiles(image, "Sharpen/Image", channels, halo, pool, [&](const Tile& tile) {
+        gaussianTile(tile, taps, kernels);
+
+        const int stride = tile.columns * tile.channels;
+        for (int y = 0; y < tile.rows; ++y) {
+            const float* x = tile.in + ((y + halo) * tile.inColumns + halo) * tile.channels;
+            float* out = tile.out + y * stride;
+            for (int i = 0; i < stride; ++i)
+                out[i] = (gain * x[i] - out[i]) * scale;
+        }
+    });
+    return true;
+}
+
+}
@@ -0,0 +1,61 @@
+// StageTimer.h
+#pragma once
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+
+/*****************************************************************************************
+    StageTimer accumulates wall time per named stage, in the order stages first appear.
+    lap() charges the time since the previous lap (or restart) to a stage, so a loop can
+    lap the same stages once per band and get per-page totals.
+
+    It also counts full-image copies: passes that move every pixel of the page from one
+    buffer to another (decode, export out of Magick, colour conversion), banded or not.
+******************************************************************************************/
+
+class StageTimer {
+public:
+    void restart() { m_timer.start(); }
+    void clear() { m_stages.clear(); m_copies = 0; }
+    void countCopy() { ++m_copies; }
+    int copies() const { return m_copies; }
+
+    void lap(const QString& stage) {
+        add(stage, m_timer.isValid() ? m_timer.nsecsElapsed() : 0);
+        m_timer.start();
+    }
+
+    // Fold another timer's totals into this one (e.g. several pages of a batch)
+    void merge(const StageTimer& other) {
+        for (const auto& entry : other.m_stages)
+            add(entry.first, entry.second);
+        m_copies += other.m_copies;
+    }
+
+    const QList<QPair<QString, qint64>>& stages() const { return m_stages; }   // Nanoseconds per stage
+
+    qint64 totalNs() const {
+        qint64 total = 0;
+        for (const auto& entry : m_stages)
+            total += entry.second;
+        return total;
+    }
+
+private:
+    QElapsedTimer m_timer;
+    QList<QPair<QString, qint64>> m_stages;
+    int m_copies = 0;
+
+    void add(const QString& stage, qint64 ns) {
+        for (auto& entry : m_stages) {
+            if (entry.first == stage) {
+                entry.second += ns;
+                return;
+            }
+        }
+        m_stages.append({ stage, ns });
+    }
+};
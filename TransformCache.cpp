@@ -0,0 +1,143 @@
+#include "TransformCache.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <algorithm>
+
+
+bool TransformCache::Key::operator==(const Key& other) const {
+    return inputHash == other.inputHash && outputHash == other.outputHash
+        && inputFormat == other.inputFormat && outputFormat == other.outputFormat
+        && intent == other.intent && flags == other.flags;
+}
+
+
+TransformCache& TransformCache::instance() {
+    static TransformCache cache;
+    return cache;
+}
+
+
+TransformCache::Transform TransformCache::transform(const QByteArray& inputProfile, cmsUInt32Number inputFormat,
+                                                    const QByteArray& outputProfile, cmsUInt32Number outputFormat,
+                                                    cmsUInt32Number intent, cmsUInt32Number flags) {
+    if (inputProfile.isEmpty() || outputProfile.isEmpty())
+        return nullptr;
+
+    // The 1-pixel cache is per transform and not thread safe
+    flags |= cmsFLAGS_NOCACHE;
+
+    // Held across creation so concurrent misses on one key build it once
+    QMutexLocker locker(&m_mutex);
+
+    const Key key = {
+        profileHash(inputProfile), profileHash(outputProfile),
+        inputFormat, outputFormat, intent, flags
+    };
+
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->first == key) {
+            m_entries.splice(m_entries.begin(), m_entries, it);
+            return it->second;
+        }
+    }
+
+    cmsHPROFILE input = cmsOpenProfileFromMem(inputProfile.constData(), static_cast<cmsUInt32Number>(inputProfile.size()));
+    cmsHPROFILE output = cmsOpenProfileFromMem(outputProfile.constData(), static_cast<cmsUInt32Number>(outputProfile.size()));
+
+    cmsHTRANSFORM handle = (input && output)
+        ? cmsCreateTransform(input, inputFormat, output, outputFormat, intent, flags)
+        : nullptr;
+
+    if (input) cmsCloseProfile(input);
+    if (output) cmsCloseProfile(output);
+
+    if (!handle) {
+        qWarning() << "❌ Failed to create ICC transform.";
+        return nullptr;
+    }
+
+    Transform transform(handle, [](void* h) { cmsDeleteTransform(static_cast<cmsHTRANSFORM>(h)); });
+    m_entries.emplace_front(key, transform);
+    evictToCapacity();
+    return transform;
+}
+
+
+TransformCache::Transform TransformCache::transform(const QString& inputPath, cmsUInt32Number inputFormat,
+                                                    const QString& outputPath, cmsUInt32Number outputFormat,
+                                                    cmsUInt32Number intent, cmsUInt32Number flags) {
+    const QByteArray input = profileData(inputPath);
+    const QByteArray output = profileData(outputPath);
+    if (input.isEmpty() || output.isEmpty()) {
+        qWarning() << "❌ Failed to load one or both ICC profiles.";
+        return nullptr;
+    }
+    return transform(input, inputFormat, output, outputFormat, intent, flags);
+}
+
+
+QByteArray TransformCache::profileData(const QString& localPath) {
+    const QFileInfo info(localPath);
+    if (!info.isFile())
+        return QByteArray();
+
+    QMutexLocker locker(&m_mutex);
+
+    ProfileFile& file = m_files[info.absoluteFilePath()];
+    if (file.size == info.size() && file.modified == info.lastModified())
+        return file.data;
+
+    QFile profile(localPath);
+    if (!profile.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    QByteArray data = profile.readAll();
+
+    // Header and tag directory only; tags are parsed on first use
+    cmsHPROFILE handle = cmsOpenProfileFromMem(data.constData(), static_cast<cmsUInt32Number>(data.size()));
+    if (!handle) {
+        qWarning() << "Not a valid ICC profile:" << localPath;
+        data.clear();
+    } else {
+        cmsCloseProfile(handle);
+    }
+
+    file = { info.size(), info.lastModified(), data,
+             data.isEmpty() ? QByteArray() : QCryptographicHash::hash(data, QCryptographicHash::Sha1) };
+    return data;
+}
+
+
+// Caller holds m_mutex. Copies of profileData() share its buffer, so they reuse the
+// digest taken on load; anything else (embedded profiles) is hashed here.
+QByteArray TransformCache::profileHash(const QByteArray& profile) const {
+    for (const auto& [path, file] : m_files) {
+        if (file.data.constData() == profile.constData() && file.data.size() == profile.size())
+            return file.hash;
+    }
+    return QCryptographicHash::hash(profile, QCryptographicHash::Sha1);
+}
+
+
+void TransformCache::setCapacity(int capacity) {
+    QMutexLocker locker(&m_mutex);
+    m_capacity = std::max(1, capacity);
+    evictToCapacity();
+}
+
+
+void TransformCache::clear() {
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+    m_files.clear();
+}
+
+
+// Caller holds m_mutex
+void TransformCache::evictToCapacity() {
+    while (static_cast<int>(m_entries.size()) > m_capacity)
+        m_entries.pop_back();
+}
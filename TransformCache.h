@@ -0,0 +1,74 @@
+// TransformCache.h
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QMutex>
+#include <QString>
+#include <lcms2.h>
+#include <list>
+#include <map>
+#include <memory>
+
+
+/*******************************************************************************************
+    TransformCache is a process-wide LRU of lcms2 transforms, keyed by the content hash of
+    both profiles plus pixel formats, intent and flags. Transforms are always built with
+    cmsFLAGS_NOCACHE, so one handle can be used by any number of threads at once; a
+    batch of jobs with the same profiles builds its transform once. Profiles read through
+    profileData() are hashed once per load, not on every lookup.
+
+    Handles are shared: an evicted transform stays alive until its last user lets go.
+********************************************************************************************/
+
+class TransformCache {
+public:
+    using Transform = std::shared_ptr<void>;     // cmsHTRANSFORM via get()
+
+    static constexpr int DefaultCapacity = 8;
+
+    static TransformCache& instance();
+
+    // Transform between two ICC profiles held in memory; null if either is invalid
+    Transform transform(const QByteArray& inputProfile, cmsUInt32Number inputFormat,
+                        const QByteArray& outputProfile, cmsUInt32Number outputFormat,
+                        cmsUInt32Number intent, cmsUInt32Number flags);
+
+    // Same, reading the profiles through profileData()
+    Transform transform(const QString& inputPath, cmsUInt32Number inputFormat,
+                        const QString& outputPath, cmsUInt32Number outputFormat,
+                        cmsUInt32Number intent, cmsUInt32Number flags);
+
+    // ICC file contents, reread only when size or mtime change; empty if missing or not ICC
+    QByteArray profileData(const QString& localPath);
+
+    void setCapacity(int capacity);
+    void clear();
+
+private:
+    struct Key {
+        QByteArray inputHash;
+        QByteArray outputHash;
+        cmsUInt32Number inputFormat;
+        cmsUInt32Number outputFormat;
+        cmsUInt32Number intent;
+        cmsUInt32Number flags;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct ProfileFile {
+        qint64 size = -1;
+        QDateTime modified;
+        QByteArray data;
+        QByteArray hash;            // SHA-1 of data, taken when it is read
+    };
+
+    QMutex m_mutex;
+    std::list<std::pair<Key, Transform>> m_entries;     // Most recently used first
+    std::map<QString, ProfileFile> m_files;
+    int m_capacity = DefaultCapacity;
+
+    QByteArray profileHash(const QByteArray& profile) const;
+    void evictToCapacity();
+};
@@ -9,6 +9,7 @@
 #include "PrintJobOutput.h"
 #include "PrintJobNocai.h"
 #include "ImageEditor.h"
+#include "EditorPreviewProvider.h"
 #include "ColorProfile.h"
 
 
@@ -61,6 +62,9 @@ int main(int argc, char *argv[]) {
     engine.rootContext()->setContextProperty("printJobNocai", &printJobNocaiOutput);
     engine.rootContext()->setContextProperty("colorProfile", &colorProfile);
 
+    // In-memory preview of the image being edited; the engine takes ownership
+    engine.addImageProvider("editor", new EditorPreviewProvider(&imageEditor));
+
     // Load the main QML UI
     engine.load(QUrl(QStringLiteral("qrc:/qml/Main.qml")));
     if (engine.rootObjects().isEmpty())
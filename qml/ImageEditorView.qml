@@ -6,7 +6,6 @@ import Qt.labs.platform
 Page {
     id: editorPage
     required property string imagePath
-    property string tempPath: imagePath + ".edit_tmp"
 
     property bool isDirty: true
     property string currentTool: "none"
@@ -24,17 +23,13 @@ Page {
     property real gamma: 0
     property string overlayText: "Sample Text"
 
+    property real saveProgress: 0
+
     Component.onCompleted: {
-        if (imageEditor.loadImage(imagePath)) {
-            imageEditor.saveImage(tempPath)
-            if (imageEditor.loadImage(tempPath)) {
-                refreshImage()
-            } else {
-                console.warn("Failed to load temp image for editing")
-            }
-        } else {
+        // Edits run on a proxy the size of the screen; the file is only touched on save
+        imageEditor.setProxySize(Math.max(Screen.width, Screen.height) * Screen.devicePixelRatio)
+        if (!imageEditor.loadImage(imagePath))
             console.warn("Failed to load image for editing")
-        }
     }
 
     // === Main Layout ===
@@ -56,13 +51,24 @@ Page {
 
                 Image {
                     id: imagePreview
-                    source: tempPath
+                    source: imageEditor.previewUrl
+                    sourceSize: Qt.size(Screen.width * Screen.devicePixelRatio,
+                                        Screen.height * Screen.devicePixelRatio)
                     fillMode: Image.PreserveAspectFit
                     smooth: true
                     cache: false
                     anchors.fill: parent
                 }
 
+                // Edits run in the background; Undo cancels the ones still pending
+                ProgressBar {
+                    anchors.left: parent.left
+                    anchors.right: parent.right
+                    anchors.bottom: parent.bottom
+                    visible: imageEditor.busy
+                    value: imageEditor.progress
+                }
+
                 Rectangle {
                     x: cropX
                     y: cropY
@@ -307,20 +313,25 @@ Page {
 
                 Button {
                     text: "Save"
+                    enabled: !imageEditor.saving
                     onClicked: {
-                        if (imageEditor.saveImage(imagePath)) {
-                            isDirty = false
-                            toast.show("Image saved.")
-                        }
+                        saveProgress = 0
+                        if (!imageEditor.saveImageAsync(imagePath))
+                            toast.show("Image could not be saved.")
                     }
                 }
 
+                ProgressBar {
+                    visible: imageEditor.saving
+                    value: saveProgress
+                    Layout.preferredWidth: 120
+                }
+
                 Button {
                     text: "Undo"
                     onClicked: {
                         if (imageEditor.undo()) {
                             isDirty = true
-                            refreshImage()
                         }
                     }
                 }
@@ -330,7 +341,6 @@ Page {
                     onClicked: {
                         if (imageEditor.redo()) {
                             isDirty = true
-                            refreshImage()
                         }
                     }
                 }
@@ -357,12 +367,32 @@ Page {
         parent: Overlay.overlay
     }
 
-    function refreshImage() {
-        imagePreview.source = tempPath + "?" + Date.now()
+    // Edits and saving both run in the background
+    Connections {
+        target: imageEditor
+
+        onSaveProgress: function(fraction) {
+            saveProgress = fraction
+        }
+
+        onOperationFinished: function(name, success) {
+            if (!success)
+                toast.show("Could not apply " + name + ".")
+        }
+
+        onSaveFinished: function(success, path) {
+            if (path !== imagePath)
+                return
+            if (success) {
+                isDirty = false
+                toast.show("Image saved.")
+            } else {
+                toast.show("Image could not be saved.")
+            }
+        }
     }
 
     function cleanupAndExit() {
-        imageEditor.deleteFile(tempPath)
         stackView.pop()
     }
 
@@ -394,8 +424,6 @@ Page {
             try {
                 ok = actions[type]()
                 isDirty = true
-                imageEditor.saveImage(tempPath)
-                refreshImage()
             }
             catch (err) {
                 console.warn("Error executing action:", type, err)
@@ -10,6 +10,7 @@ Item {
     property var jobData: jobModel.getJob(jobIndex)
     property string imagePath: jobData.imagePath
     property var imageMeta: ({})
+    property string pendingImage: ""                // File being inspected, replaces imagePath when valid
     property var appState
     property string selectedInputICC: ""
     property string selectedOutputICC: ""
@@ -114,7 +115,42 @@ Item {
     }
 
     function updateMetadata(path) {
-        imageMeta = imageLoader.extractMetadata(path)
+        imageLoader.inspectFileAsync(path)
+    }
+
+    // Inspection runs off the GUI thread; picking another file cancels the previous one
+    function inspectNewImage(path) {
+        pendingImage = path
+        imageLoader.inspectFileAsync(path)
+    }
+
+    Connections {
+        target: imageLoader
+
+        onFileInspected: function(request, path, valid, metadata) {
+            if (path === pendingImage) {
+                pendingImage = ""
+                if (!valid) {
+                    console.warn("File validation failed.")
+                    return
+                }
+                updateImagePath(path)
+                imagePath = path
+                imageMeta = metadata
+                if (imageMeta.width > 0 && imageMeta.height > 0) {
+                    updateResolutionFromMetadata()
+                }
+            }
+            else if (path === imagePath) {
+                imageMeta = metadata
+            }
+        }
+
+        // Follows fileInspected once the preview has been decoded
+        onThumbnailReady: function(request, path, metadata) {
+            if (path === imagePath)
+                imageMeta = metadata
+        }
     }
 
     ColumnLayout {
@@ -224,18 +260,7 @@ Item {
                             nameFilters: ["Images (*.png *.jpg *.jpeg *.bmp *.tif *.tiff *.svg *.pdf)"]
                             onAccepted: {
                                 if (imageLoader.isSupportedExtension(file)) {
-                                    if (imageLoader.validateFile(file)) {
-                                        updateMetadata(file)
-                                        updateImagePath(file)
-                                        imagePath = file
-
-                                        if (imageMeta.width > 0 && imageMeta.height > 0) {
-                                            updateResolutionFromMetadata()
-                                        }
-                                    }
-                                    else {
-                                        console.warn("File validation failed.")
-                                    }
+                                    inspectNewImage(file)
                                 }
                                 else {
                                     console.warn("Unsupported file type.")
@@ -475,6 +500,15 @@ Item {
                             Column {
                                 spacing: 4
 
+                                Image {
+                                    source: imageMeta.thumbnail !== undefined ? imageMeta.thumbnail : ""
+                                    visible: imageMeta.thumbnail !== undefined
+                                    fillMode: Image.PreserveAspectFit
+                                    width: 128
+                                    height: 128
+                                    asynchronous: true
+                                }
+
                                 // Always shown if present
                                 Text { text: "Name: " + imageMeta.name; color: "white"; visible: imageMeta.name !== undefined }
                                 Text { text: "Size: " + imageMeta.size + " bytes"; color: "white"; visible: imageMeta.size !== undefined }
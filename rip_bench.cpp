@@ -0,0 +1,595 @@
+#include <benchmark/benchmark.h>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QThreadPool>
+#include <QUrl>
+#include <lcms2.h>
+#include <Magick++.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ColorLUT.h"
+#include "ColorProfile.h"
+#include "ImagePlane.h"
+#include "MaskCache.h"
+#include "NocaiBandPipeline.h"
+#include "NocaiKernels.h"
+#include "PRNWriter.h"
+#include "ParallelTransform.h"
+#include "PrintJobNocai.h"
+#include "SeparableBlur.h"
+#include "TransformCache.h"
+
+
+/****************************************************************************
+    RIP hot path benchmarks on synthetic pages from 1 to 150 megapixels.
+    Every benchmark reports throughput (MP/s) and the process peak RSS.
+
+        rip_bench --benchmark_filter=Kernel     per-pixel screening kernels
+        rip_bench --benchmark_filter=blur       native blur against ImageMagick's
+        rip_bench --benchmark_filter=150        largest pages only
+
+    Row kernels and the band pipeline stream a page through one band of
+    buffers, as the RIP does. The ICC benchmarks go through the public
+    file-based entry points, so they include decode and encode.
+****************************************************************************/
+
+namespace {
+
+const std::vector<int64_t> PageMegapixels = { 1, 10, 50, 150 };
+constexpr int BandRows = NocaiBandPipeline::DefaultBandRows;
+
+
+struct PageSize {
+    int width = 0;
+    int height = 0;
+    int64_t pixels() const { return static_cast<int64_t>(width) * height; }
+};
+
+// 4:3 page of roughly the requested size
+PageSize pageFor(int64_t megapixels) {
+    const int width = static_cast<int>(std::lround(std::sqrt(megapixels * 1e6 * 4.0 / 3.0)));
+    return { width, static_cast<int>(megapixels * 1000000 / width) };
+}
+
+
+QTemporaryDir& scratchDir() {
+    static QTemporaryDir dir;
+    return dir;
+}
+
+QThreadPool& benchPool() {
+    static QThreadPool pool;
+    return pool;
+}
+
+
+// Smooth gradients plus noise, so neither lcms nor the screen sees flat input
+void fillRGB(uint8_t* rgb, int width, int y0, int rows, int height) {
+    uint32_t seed = 0x9E3779B9u ^ static_cast<uint32_t>(y0);
+    for (int r = 0; r < rows; ++r) {
+        for (int x = 0; x < width; ++x) {
+            seed = seed * 1664525u + 1013904223u;
+            uint8_t* px = rgb + (static_cast<size_t>(r) * width + x) * 3;
+            px[0] = static_cast<uint8_t>(x * 255 / std::max(1, width - 1));
+            px[1] = static_cast<uint8_t>((y0 + r) * 255 / std::max(1, height - 1));
+            px[2] = static_cast<uint8_t>(seed >> 24);
+        }
+    }
+}
+
+void fillInk(const PlaneView& plane, int y0) {
+    uint32_t seed = 0x85EBCA6Bu ^ static_cast<uint32_t>(y0);
+    for (int r = 0; r < plane.height; ++r) {
+        uint8_t* row = plane.row(r);
+        for (int x = 0; x < plane.width; ++x) {
+            seed = seed * 1664525u + 1013904223u;
+            row[x] = static_cast<uint8_t>(((x + y0 + r) & 255) ^ (seed >> 28));
+        }
+    }
+}
+
+
+// Synthetic TIFF per page size, written once per process
+QString syntheticImage(int64_t megapixels) {
+    static std::map<int64_t, QString> paths;
+    auto it = paths.find(megapixels);
+    if (it != paths.end()) return it->second;
+
+    const PageSize page = pageFor(megapixels);
+    std::vector<uint8_t> rgb(static_cast<size_t>(page.pixels()) * 3);
+    fillRGB(rgb.data(), page.width, 0, page.height, page.height);
+
+    const QString path = scratchDir().filePath(QString("page_%1mp.tiff").arg(megapixels));
+    Magick::Image image(page.width, page.height, "RGB", Magick::CharPixel, rgb.data());
+    image.depth(8);
+    image.write(path.toStdString());
+    return paths.emplace(megapixels, path).first->second;
+}
+
+QString extractedAsset(const QString& name) {
+    const QString path = scratchDir().filePath(name);
+    if (!QFile::exists(path))
+        QFile::copy(":/assets/" + name, path);
+    return path;
+}
+
+
+void reportCounters(benchmark::State& state, int64_t pixels) {
+    state.counters["MP/s"] = benchmark::Counter(pixels / 1e6, benchmark::Counter::kIsIterationInvariantRate);
+
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    state.counters["peakRSS_MB"] = usage.ru_maxrss / 1024.0;   // Process-wide high-water mark
+}
+
+
+std::array<MaskTile, 4> benchMasks() {
+    std::array<MaskTile, 4> masks;
+    if (!MaskCache::channelTiles(512, masks)) {
+        // Fall back to a flat tile so kernel timings are still available
+        static std::vector<uint8_t> flat(64 * 64, 128);
+        for (int ch = 0; ch < 4; ++ch)
+            masks[ch] = { flat.data(), 64, 64, MaskCache::RollOffsets[ch], MaskCache::RollOffsets[ch] };
+    }
+    return masks;
+}
+
+}
+
+
+// === ICC ===
+
+static void BM_ColorProfile_convertWithICCProfiles(benchmark::State& state) {
+    const QString input = syntheticImage(state.range(0));
+    const QString srgb = extractedAsset("sRGBProfile.icm");
+    const QString output = QUrl::fromLocalFile(scratchDir().filePath("converted.tiff")).toString();
+
+    ColorProfile profile;
+    if (!profile.loadProfiles(srgb, srgb)) {
+        state.SkipWithError("ICC profiles unavailable");
+        return;
+    }
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(profile.convertWithICCProfiles(QUrl::fromLocalFile(input).toString(), output));
+
+    reportCounters(state, pageFor(state.range(0)).pixels());
+}
+BENCHMARK(BM_ColorProfile_convertWithICCProfiles)->ArgsProduct({ PageMegapixels })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+// The step-by-step pipeline: conversion set up once, then decode, convert and screen streamed per band
+static void BM_PrintJobNocai_generateFinalPRN(benchmark::State& state) {
+    const QString srgb = QUrl::fromLocalFile(extractedAsset("sRGBProfile.icm")).toString();
+    const QString paper = QUrl::fromLocalFile(extractedAsset("RIP_App_Plain_Paper.icm")).toString();
+    const QString prn = QUrl::fromLocalFile(scratchDir().filePath("steps.prn")).toString();
+
+    PrintJobNocai nocai;
+    if (!nocai.loadInputImage(QUrl::fromLocalFile(syntheticImage(state.range(0))).toString())
+        || !nocai.applyICCConversion(srgb, paper)) {
+        state.SkipWithError("Input image or ICC profiles unavailable");
+        return;
+    }
+
+    for (auto _ : state) {
+        if (!nocai.generateFinalPRN(prn, 720, 720)) {
+            state.SkipWithError("generateFinalPRN failed");
+            return;
+        }
+    }
+
+    reportCounters(state, pageFor(state.range(0)).pixels());
+}
+BENCHMARK(BM_PrintJobNocai_generateFinalPRN)->ArgsProduct({ PageMegapixels })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+// The 16-bit transform generatePRNNative runs, one band at a time on one thread
+static void BM_Nocai_transform16(benchmark::State& state) {
+    const PageSize page = pageFor(state.range(0));
+
+    const TransformCache::Transform transform = TransformCache::instance().transform(
+        extractedAsset("sRGBProfile.icm"), TYPE_RGB_16,
+        extractedAsset("RIP_App_Plain_Paper.icm"), TYPE_CMYK_16,
+        INTENT_PERCEPTUAL, cmsFLAGS_HIGHRESPRECALC);
+    if (!transform) {
+        state.SkipWithError("ICC transform unavailable");
+        return;
+    }
+
+    std::vector<uint8_t> rgb8(static_cast<size_t>(page.width) * BandRows * 3);
+    std::vector<uint16_t> rgb16(rgb8.size());
+    std::vector<uint16_t> cmyk16(static_cast<size_t>(page.width) * BandRows * 4);
+    fillRGB(rgb8.data(), page.width, 0, BandRows, page.height);
+    for (size_t i = 0; i < rgb8.size(); ++i)
+        rgb16[i] = static_cast<uint16_t>(rgb8[i] * 257);
+
+    for (auto _ : state) {
+        for (int y0 = 0; y0 < page.height; y0 += BandRows) {
+            const int rows = std::min(BandRows, page.height - y0);
+            cmsDoTransform(transform.get(), rgb16.data(), cmyk16.data(), static_cast<cmsUInt32Number>(page.width) * rows);
+        }
+        benchmark::ClobberMemory();
+    }
+
+    reportCounters(state, page.pixels());
+}
+BENCHMARK(BM_Nocai_transform16)->ArgsProduct({ PageMegapixels })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+// Cost of a transform lookup: range(0) == 0 rebuilds every time, 1 hits the cache
+static void BM_TransformCache_sRGBToPaper(benchmark::State& state) {
+    const QString srgb = extractedAsset("sRGBProfile.icm");
+    const QString paper = extractedAsset("RIP_App_Plain_Paper.icm");
+    TransformCache& cache = TransformCache::instance();
+
+    for (auto _ : state) {
+        if (state.range(0) == 0)
+            cache.clear();
+        benchmark::DoNotOptimize(cache.transform(srgb, TYPE_RGB_16, paper, TYPE_CMYK_16, INTENT_PERCEPTUAL, cmsFLAGS_HIGHRESPRECALC));
+    }
+
+    state.SetLabel(state.range(0) == 0 ? "build" : "hit");
+}
+BENCHMARK(BM_TransformCache_sRGBToPaper)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+
+// Whole-page 8-bit RGB -> CMYK through parallelTransform; range(1) is the worker count
+static void BM_ParallelTransform_sRGBToPaper(benchmark::State& state) {
+    const PageSize page = pageFor(state.range(0));
+    const TransformCache::Transform transform = TransformCache::instance().transform(
+        extractedAsset("sRGBProfile.icm"), TYPE_RGB_8,
+        extractedAsset("RIP_App_Plain_Paper.icm"), TYPE_CMYK_8,
+        INTENT_PERCEPTUAL, 0);
+    if (!transform) {
+        state.SkipWithError("ICC profiles unavailable");
+        return;
+    }
+
+    std::vector<uint8_t> rgb(static_cast<size_t>(page.pixels()) * 3);
+    std::vector<uint8_t> cmyk(static_cast<size_t>(page.pixels()) * 4);
+    fillRGB(rgb.data(), page.width, 0, page.height, page.height);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(static_cast<int>(state.range(1)));
+
+    for (auto _ : state) {
+        parallelTransform(&pool, transform.get(), rgb.data(), cmyk.data(), page.width, page.height);
+        benchmark::DoNotOptimize(cmyk.data());
+    }
+
+    reportCounters(state, page.pixels());
+}
+BENCHMARK(BM_ParallelTransform_sRGBToPaper)->ArgsProduct({ { 10, 100 }, { 1, 2, 4, 8 } })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+// Same conversion through the baked LUT; the first run per machine builds and caches it
+static void BM_ColorLUT_sRGBToPaper(benchmark::State& state) {
+    const PageSize page = pageFor(state.range(0));
+    const std::shared_ptr<const ColorLUT> lut = ColorLUT::forProfiles(
+        TransformCache::instance().profileData(extractedAsset("sRGBProfile.icm")),
+        TransformCache::instance().profileData(extractedAsset("RIP_App_Plain_Paper.icm")),
+        INTENT_PERCEPTUAL);
+    if (!lut) {
+        state.SkipWithError("No color LUT within tolerance");
+        return;
+    }
+
+    std::vector<uint8_t> rgb(static_cast<size_t>(page.pixels()) * 3);
+    std::vector<uint8_t> cmyk(static_cast<size_t>(page.pixels()) * 4);
+    fillRGB(rgb.data(), page.width, 0, page.height, page.height);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(static_cast<int>(state.range(1)));
+
+    for (auto _ : state) {
+        parallelFor(&pool, page.height, [&](int begin, int end) {
+            const size_t first = static_cast<size_t>(begin) * page.width;
+            lut->apply(rgb.data() + first * 3, cmyk.data() + first * 4, (end - begin) * page.width);
+        });
+        benchmark::DoNotOptimize(cmyk.data());
+    }
+
+    state.SetLabel(QString("%1^3, max dE00 %2").arg(lut->gridPoints()).arg(lut->maxDeltaE(), 0, 'f', 2).toStdString());
+    reportCounters(state, page.pixels());
+}
+BENCHMARK(BM_ColorLUT_sRGBToPaper)->ArgsProduct({ { 10, 100 }, { 1, 2, 4, 8 } })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+// === Screening kernels (one channel, per ISA) ===
+
+enum class Kernel { Threshold, Classify, Pack2bpp };
+
+template <Kernel K>
+static void BM_Kernel(benchmark::State& state) {
+    const NocaiKernels::Table& kernels = NocaiKernels::forIsa(static_cast<NocaiKernels::Isa>(state.range(1)));
+    if (kernels.isa != static_cast<NocaiKernels::Isa>(state.range(1))) {
+        state.SkipWithError("ISA not supported on this CPU");
+        return;
+    }
+
+    const PageSize page = pageFor(state.range(0));
+    ImagePlane ink(page.width, BandRows), mask(page.width, BandRows), out(page.width, BandRows);
+    fillInk(ink, 0);
+    fillInk(mask, 7);
+
+    for (auto _ : state) {
+        for (int y0 = 0; y0 < page.height; y0 += BandRows) {
+            const int rows = std::min(BandRows, page.height - y0);
+            for (int r = 0; r < rows; ++r) {
+                if (K == Kernel::Threshold) kernels.threshold(ink.row(r), mask.row(r), out.row(r), page.width);
+                if (K == Kernel::Classify) kernels.classify(ink.row(r), mask.row(r), out.row(r), page.width);
+                if (K == Kernel::Pack2bpp) kernels.pack2bpp(ink.row(r), out.row(r), page.width);
+            }
+        }
+        benchmark::ClobberMemory();
+    }
+
+    state.SetLabel(NocaiKernels::isaName(kernels.isa));
+    reportCounters(state, page.pixels());
+}
+
+static void kernelArgs(benchmark::internal::Benchmark* bench) {
+    for (int64_t megapixels : PageMegapixels)
+        for (NocaiKernels::Isa isa : { NocaiKernels::Isa::Scalar, NocaiKernels::Isa::SSE2, NocaiKernels::Isa::AVX2 })
+            bench->Args({ megapixels, static_cast<int64_t>(isa) });
+}
+
+BENCHMARK(BM_Kernel<Kernel::Threshold>)->Name("BM_Kernel_threshold")->Apply(kernelArgs)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Kernel<Kernel::Classify>)->Name("BM_Kernel_dotClassification")->Apply(kernelArgs)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Kernel<Kernel::Pack2bpp>)->Name("BM_Kernel_packTo2BPP")->Apply(kernelArgs)->Unit(benchmark::kMillisecond);
+
+
+// === Band pipeline (four channels, shared thread pool) ===
+
+// classify + 4x4 promotion + pack + write: the promotion is what separates this from the kernels above
+static void BM_Pipeline_classifyPromoteWrite(benchmark::State& state) {
+    const PageSize page = pageFor(state.range(0));
+    const std::array<MaskTile, 4> masks = benchMasks();
+    const QString prn = scratchDir().filePath("bench.prn");
+
+    ImagePlane threshold(page.width, BandRows);
+    fillInk(threshold, 97);
+
+    std::array<ImagePlane, 4> dithered;
+    for (int ch = 0; ch < 4; ++ch) {
+        dithered[ch].reset(page.width, BandRows);
+        fillInk(dithered[ch], ch * 31);
+        NocaiKernels::threshold(dithered[ch], threshold, dithered[ch]);     // 0 / 255
+    }
+
+    for (auto _ : state) {
+        NocaiBandPipeline pipeline;
+        pipeline.setThreadPool(&benchPool());
+        pipeline.begin(prn, page.width, page.height, 720, 720, masks);
+
+        for (int y0 = 0; y0 < page.height; y0 += BandRows) {
+            const int rows = std::min(BandRows, page.height - y0);
+            pipeline.classifyBands({ dithered[0].view().rows(0, rows), dithered[1].view().rows(0, rows),
+                                     dithered[2].view().rows(0, rows), dithered[3].view().rows(0, rows) });
+            pipeline.commitBand();
+        }
+        benchmark::DoNotOptimize(pipeline.finish());
+    }
+
+    reportCounters(state, page.pixels());
+}
+BENCHMARK(BM_Pipeline_classifyPromoteWrite)->ArgsProduct({ PageMegapixels })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+// threshold + classify + promotion + pack + write, from separated ink
+static void BM_Pipeline_screenPromoteWrite(benchmark::State& state) {
+    const PageSize page = pageFor(state.range(0));
+    const std::array<MaskTile, 4> masks = benchMasks();
+    const QString prn = scratchDir().filePath("bench.prn");
+
+    std::array<ImagePlane, 4> ink;
+    for (int ch = 0; ch < 4; ++ch) {
+        ink[ch].reset(page.width, BandRows);
+        fillInk(ink[ch], ch * 31);
+    }
+
+    for (auto _ : state) {
+        NocaiBandPipeline pipeline;
+        pipeline.setThreadPool(&benchPool());
+        pipeline.begin(prn, page.width, page.height, 720, 720, masks);
+
+        for (int y0 = 0; y0 < page.height; y0 += BandRows) {
+            const int rows = std::min(BandRows, page.height - y0);
+            pipeline.screenBands({ ink[0].view().rows(0, rows), ink[1].view().rows(0, rows),
+                                   ink[2].view().rows(0, rows), ink[3].view().rows(0, rows) });
+            pipeline.commitBand();
+        }
+        benchmark::DoNotOptimize(pipeline.finish());
+    }
+
+    reportCounters(state, page.pixels());
+}
+BENCHMARK(BM_Pipeline_screenPromoteWrite)->ArgsProduct({ PageMegapixels })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+// writePRNFile's job on its own: every line of a preallocated PRN
+static void BM_PRNWriter_write(benchmark::State& state) {
+    const PageSize page = pageFor(state.range(0));
+    const int lineBytes = 4 * (((page.width + 3) / 4 + 3) / 4 * 4);
+    const uint32_t header[PRNWriter::HeaderFields] = { 0x5555, 720, 720, static_cast<uint32_t>(lineBytes / 4),
+                                                       static_cast<uint32_t>(page.height), static_cast<uint32_t>(page.width),
+                                                       0, 4, 1, 1, 0, 0 };
+    const QString prn = scratchDir().filePath("bench.prn");
+
+    bool mapped = false;
+    for (auto _ : state) {
+        PRNWriter writer;
+        writer.open(prn, header, lineBytes, page.height, BandRows);
+        for (int y0 = 0; y0 < page.height; y0 += BandRows) {
+            const int rows = std::min(BandRows, page.height - y0);
+            const PlaneView band = writer.rows(y0, rows);
+            for (int r = 0; r < rows; ++r)
+                std::memset(band.row(r), 0x5A, lineBytes);
+            writer.commit(y0, rows);
+        }
+        mapped = writer.isMapped();
+        benchmark::DoNotOptimize(writer.close());
+    }
+
+    state.SetLabel(mapped ? "mapped" : "staged");
+    reportCounters(state, page.pixels());
+}
+BENCHMARK(BM_PRNWriter_write)->ArgsProduct({ PageMegapixels })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+// === Blur and sharpen (native tiles vs ImageMagick) ===
+
+namespace {
+
+// Page-sized RGB image in memory, as the editor holds it
+const Magick::Image& editorImage(int64_t megapixels) {
+    static std::map<int64_t, Magick::Image> images;
+    auto it = images.find(megapixels);
+    if (it != images.end()) return it->second;
+
+    const PageSize page = pageFor(megapixels);
+    std::vector<uint8_t> rgb(static_cast<size_t>(page.pixels()) * 3);
+    fillRGB(rgb.data(), page.width, 0, page.height, page.height);
+    return images.emplace(megapixels, Magick::Image(page.width, page.height, "RGB", Magick::CharPixel, rgb.data()))
+        .first->second;
+}
+
+// Largest difference of a sample in [0, 1] between native and reference, on the 1 MP page
+template <typename Native, typename Reference>
+double maxError(Native native, Reference reference) {
+    Magick::Image a = editorImage(1), b = editorImage(1);
+    native(a);
+    reference(b);
+
+    const size_t count = a.columns() * a.rows() * 3;
+    std::vector<float> pa(count), pb(count);
+    a.write(0, 0, a.columns(), a.rows(), "RGB", Magick::FloatPixel, pa.data());
+    b.write(0, 0, b.columns(), b.rows(), "RGB", Magick::FloatPixel, pb.data());
+
+    double error = 0.0;
+    for (size_t i = 0; i < count; ++i)
+        error = std::max(error, static_cast<double>(std::fabs(pa[i] - pb[i])));
+    return error;
+}
+
+}
+
+
+// range(1) is sigma; from BoxSigmaThreshold the native blur switches to boxes
+static void BM_SeparableBlur_blur(benchmark::State& state) {
+    const Magick::Image& page = editorImage(state.range(0));
+    const double sigma = static_cast<double>(state.range(1));
+
+    for (auto _ : state) {
+        Magick::Image image = page;
+        if (!SeparableBlur::blur(image, 0.0, sigma)) {
+            state.SkipWithError("image not supported by SeparableBlur");
+            return;
+        }
+    }
+
+    const bool box = sigma >= SeparableBlur::BoxSigmaThreshold;
+    state.SetLabel(std::string(box ? "box, " : "gaussian, ") + NocaiKernels::isaName(SeparableBlur::active().isa));
+    const double error = maxError([sigma](Magick::Image& image) { SeparableBlur::blur(image, 0.0, sigma); },
+                                  [sigma](Magick::Image& image) { image.blur(0.0, sigma); });
+    state.counters["maxError"] = error;
+    if (error > (box ? SeparableBlur::BoxTolerance : SeparableBlur::GaussianTolerance))
+        state.SkipWithError("result differs from Image::blur beyond tolerance");
+    reportCounters(state, pageFor(state.range(0)).pixels());
+}
+BENCHMARK(BM_SeparableBlur_blur)->ArgsProduct({ { 10, 50 }, { 1, 4, 24 } })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+static void BM_Magick_blur(benchmark::State& state) {
+    const Magick::Image& page = editorImage(state.range(0));
+    const double sigma = static_cast<double>(state.range(1));
+
+    for (auto _ : state) {
+        Magick::Image image = page;
+        image.blur(0.0, sigma);
+    }
+
+    reportCounters(state, pageFor(state.range(0)).pixels());
+}
+BENCHMARK(BM_Magick_blur)->ArgsProduct({ { 10, 50 }, { 1, 4, 24 } })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+// SharpenImage convolves with a full 2-D kernel, so sigmas stay small for ImageMagick's sake
+static void BM_SeparableBlur_sharpen(benchmark::State& state) {
+    const Magick::Image& page = editorImage(state.range(0));
+    const double sigma = static_cast<double>(state.range(1));
+
+    for (auto _ : state) {
+        Magick::Image image = page;
+        if (!SeparableBlur::sharpen(image, 0.0, sigma)) {
+            state.SkipWithError("image not supported by SeparableBlur");
+            return;
+        }
+    }
+
+    state.SetLabel(NocaiKernels::isaName(SeparableBlur::active().isa));
+    const double error = maxError([sigma](Magick::Image& image) { SeparableBlur::sharpen(image, 0.0, sigma); },
+                                  [sigma](Magick::Image& image) { image.sharpen(0.0, sigma); });
+    state.counters["maxError"] = error;
+    if (error > SeparableBlur::GaussianTolerance)
+        state.SkipWithError("result differs from Image::sharpen beyond tolerance");
+    reportCounters(state, pageFor(state.range(0)).pixels());
+}
+BENCHMARK(BM_SeparableBlur_sharpen)->ArgsProduct({ { 10, 50 }, { 1, 2 } })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+static void BM_Magick_sharpen(benchmark::State& state) {
+    const Magick::Image& page = editorImage(state.range(0));
+    const double sigma = static_cast<double>(state.range(1));
+
+    for (auto _ : state) {
+        Magick::Image image = page;
+        image.sharpen(0.0, sigma);
+    }
+
+    reportCounters(state, pageFor(state.range(0)).pixels());
+}
+BENCHMARK(BM_Magick_sharpen)->ArgsProduct({ { 10, 50 }, { 1, 2 } })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+// === End to end ===
+
+static void BM_PrintJobNocai_generatePRNNative(benchmark::State& state) {
+    const QString input = QUrl::fromLocalFile(syntheticImage(state.range(0))).toString();
+    const QString prn = QUrl::fromLocalFile(scratchDir().filePath("native.prn")).toString();
+
+    PrintJobNocai nocai;
+    for (auto _ : state) {
+        if (!nocai.generatePRNNative(input, prn, 720, 720)) {
+            state.SkipWithError("generatePRNNative failed");
+            return;
+        }
+    }
+
+    reportCounters(state, pageFor(state.range(0)).pixels());
+}
+BENCHMARK(BM_PrintJobNocai_generatePRNNative)->ArgsProduct({ PageMegapixels })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("rip_bench");
+    Magick::InitializeMagick(*argv);
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSize>
+#include <QTextStream>
+#include <QUrl>
+#include <algorithm>
+
+#include "PrintJobModel.h"
+#include "PrintJobNocai.h"
+#include "StageTimer.h"
+
+
+/****************************************************************************
+    Headless entry point for batch RIPs and benchmarking.
+        - Takes a job JSON (PrintJobModel::saveToJson format) or a single
+        image, writes one Nocai PRN per job through PrintJobNocai and
+        prints per-stage timing at the end.
+
+    ripcli jobs.json [-o outdir]
+    ripcli photo.png -o photo.prn --xdpi 720 --ydpi 720
+****************************************************************************/
+
+namespace {
+
+struct CliJob {
+    QString name;
+    QString imagePath;      // Local path
+    QString outputPath;     // Local path
+    int xdpi = 0;
+    int ydpi = 0;
+};
+
+
+QString safeFileName(QString name) {
+    name.replace(QRegularExpression("[^A-Za-z0-9._-]+"), "_");
+    return name.isEmpty() ? QString("job") : name;
+}
+
+
+void printTimings(QTextStream& out, const StageTimer& timer, qint64 pixels) {
+    for (const auto& stage : timer.stages())
+        out << QString("  %1 %2 ms\n").arg(stage.first, -10).arg(stage.second / 1e6, 10, 'f', 1);
+
+    const double totalMs = timer.totalNs() / 1e6;
+    out << QString("  %1 %2 ms").arg("total", -10).arg(totalMs, 10, 'f', 1);
+    if (pixels > 0 && totalMs > 0)
+        out << QString("   %1 MP/s").arg(pixels / 1e3 / totalMs, 0, 'f', 1);
+    out << "\n";
+    out << QString("  %1 %2\n").arg("copies", -10).arg(timer.copies(), 10);
+}
+
+}
+
+
+int main(int argc, char *argv[]) {
+
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ripcli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless Nocai PRN RIP");
+    parser.addHelpOption();
+    parser.addPositionalArgument("input", "Job JSON file or input image");
+
+    QCommandLineOption outputOption({ "o", "output" }, "PRN file (image input) or directory (job JSON).", "path");
+    QCommandLineOption xdpiOption("xdpi", "Horizontal resolution for image input, or jobs without one.", "dpi", "720");
+    QCommandLineOption ydpiOption("ydpi", "Vertical resolution for image input, or jobs without one.", "dpi", "720");
+    QCommandLineOption threadsOption({ "t", "threads" }, "Screening threads (default: one per core).", "count", "0");
+    QCommandLineOption repeatOption("repeat", "Run every job this many times (benchmarking).", "count", "1");
+    QCommandLineOption scriptOption("script", "Use the cmyk_dither_mask.sh pipeline instead of the native one.");
+    parser.addOptions({ outputOption, xdpiOption, ydpiOption, threadsOption, repeatOption, scriptOption });
+
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    const QStringList inputs = parser.positionalArguments();
+    if (inputs.size() != 1) {
+        parser.showHelp(2);
+    }
+
+    const QFileInfo input(inputs.first());
+    if (!input.exists()) {
+        err << "Input not found: " << input.filePath() << "\n";
+        return 2;
+    }
+
+    const int defaultXdpi = parser.value(xdpiOption).toInt();
+    const int defaultYdpi = parser.value(ydpiOption).toInt();
+    const int repeat = std::max(1, parser.value(repeatOption).toInt());
+
+    // === Build the job list ===
+    QList<CliJob> jobs;
+
+    if (input.suffix().compare("json", Qt::CaseInsensitive) == 0) {
+        const QString outputDir = parser.isSet(outputOption) ? parser.value(outputOption) : input.absolutePath();
+        QDir().mkpath(outputDir);
+
+        PrintJobModel model;
+        model.loadFromJson(QUrl::fromLocalFile(input.absoluteFilePath()).toString());
+
+        for (int i = 0; i < model.rowCount(); ++i) {
+            const QVariantMap job = model.getJob(i);
+            const QUrl imageUrl(job["imagePath"].toString());
+            const QSize resolution = job["resolution"].toSize();
+            const QString name = job["name"].toString().isEmpty() ? job["id"].toString() : job["name"].toString();
+
+            CliJob cliJob;
+            cliJob.name = name;
+            cliJob.imagePath = imageUrl.isLocalFile() ? imageUrl.toLocalFile() : job["imagePath"].toString();
+            cliJob.outputPath = QDir(outputDir).filePath(safeFileName(name) + ".prn");
+            cliJob.xdpi = resolution.width() > 0 ? resolution.width() : defaultXdpi;
+            cliJob.ydpi = resolution.height() > 0 ? resolution.height() : defaultYdpi;
+            jobs.append(cliJob);
+        }
+
+        if (jobs.isEmpty()) {
+            err << "No jobs in " << input.filePath() << "\n";
+            return 2;
+        }
+    } else {
+        CliJob cliJob;
+        cliJob.name = input.completeBaseName();
+        cliJob.imagePath = input.absoluteFilePath();
+        cliJob.outputPath = parser.isSet(outputOption)
+            ? parser.value(outputOption)
+            : input.absoluteDir().filePath(input.completeBaseName() + ".prn");
+        cliJob.xdpi = defaultXdpi;
+        cliJob.ydpi = defaultYdpi;
+        jobs.append(cliJob);
+    }
+
+    // === RIP ===
+    PrintJobNocai nocai;
+    nocai.setWorkerCount(parser.value(threadsOption).toInt());
+    nocai.setUseScriptPipeline(parser.isSet(scriptOption));
+    nocai.prepareNocaiAssets();
+
+    out << "Pipeline: " << (parser.isSet(scriptOption) ? "script" : "native")
+        << ", " << nocai.workerCount() << " threads\n";
+
+    StageTimer batchTimings;
+    qint64 batchPixels = 0;
+    int failures = 0;
+
+    for (const CliJob& job : jobs) {
+        for (int run = 0; run < repeat; ++run) {
+            const QString outputUrl = QUrl::fromLocalFile(QFileInfo(job.outputPath).absoluteFilePath()).toString();
+
+            const bool ok = parser.isSet(scriptOption)
+                ? nocai.generatePRNviaScript(job.imagePath, outputUrl, job.xdpi, job.ydpi)
+                : nocai.generatePRNNative(job.imagePath, outputUrl, job.xdpi, job.ydpi);
+
+            // Page size from the PRN header: width and height are fields 5 and 4
+            qint64 pixels = 0;
+            QFile prn(job.outputPath);
+            if (ok && prn.open(QIODevice::ReadOnly)) {
+                uint32_t header[12] = {};
+                if (prn.read(reinterpret_cast<char*>(header), sizeof(header)) == qint64(sizeof(header)))
+                    pixels = static_cast<qint64>(header[4]) * header[5];
+            }
+
+            out << (ok ? "OK   " : "FAIL ") << job.name << " -> " << job.outputPath
+                << " (" << job.xdpi << "x" << job.ydpi << " dpi)\n";
+            printTimings(out, nocai.stageTimings(), pixels);
+            out.flush();
+
+            if (!ok) {
+                ++failures;
+                continue;
+            }
+            batchTimings.merge(nocai.stageTimings());
+            batchPixels += pixels;
+        }
+    }
+
+    if (jobs.size() * repeat > 1) {
+        out << "\nBatch: " << (jobs.size() * repeat - failures) << " of " << (jobs.size() * repeat) << " PRNs written\n";
+        printTimings(out, batchTimings, batchPixels);
+    }
+
+    return failures == 0 ? 0 : 1;
+}
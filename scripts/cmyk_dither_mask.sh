@@ -66,21 +66,17 @@ for CHANNEL in c m y k; do
   MASK_TMP="${WORKDIR}/mask_${CHANNEL}.tiff"
   MASK_SRC="${MASKS[$CHANNEL]}"
 
-  WIDTH=$("$MAGICK" identify -format "%w" "$INPUT")
-  HEIGHT=$("$MAGICK" identify -format "%h" "$INPUT")
-
   OFFSETX=${OFFSET_X[$CHANNEL]}
   OFFSETY=${OFFSET_Y[$CHANNEL]}
 
-  # Roll and crop mask
+  # Roll mask
   "$MAGICK" "$MASK_SRC" \
-    -virtual-pixel tile -roll +${OFFSETX}+${OFFSETY} \
-    -crop "${WIDTH}x${HEIGHT}+0+0" +repage \
+    -roll +${OFFSETX}+${OFFSETY} \
     "$MASK_TMP"
 
-  # Apply FM screening
+  # Apply FM screening, repeating the mask tile across pages larger than it
   "$MAGICK" "$INPUT" "$MASK_TMP" \
-    -fx 'u>=v?1:0' -type bilevel "$OUTPUT"
+    -virtual-pixel tile -fx 'u>=v?1:0' -type bilevel "$OUTPUT"
 
   # Keep the mask for later dot size analysis
   mv "$MASK_TMP" "${WORKDIR}/${BASENAME}_${CHANNEL}_mask.tiff"
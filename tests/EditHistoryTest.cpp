@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <Magick++.h>
+#include <cstdint>
+#include <vector>
+
+#include "EditHistory.h"
+#include "PointKernel.h"
+
+
+/*
+    EditHistory as ImageEditor drives it for sliders: each new value of an adjustment
+    is computed from the state before its entry and replaces that entry, so a drag
+    leaves a single undo step holding its final value.
+*/
+
+namespace {
+
+std::vector<uint16_t> pixels(Magick::Image image) {       // By value: Image::write is not const
+    std::vector<uint16_t> rgb(image.columns() * image.rows() * 3);
+    image.write(0, 0, image.columns(), image.rows(), "RGB", Magick::ShortPixel, rgb.data());
+    return rgb;
+}
+
+
+Magick::Image gradient(int width, int height) {
+    std::vector<uint16_t> rgb(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint16_t* p = rgb.data() + (static_cast<size_t>(y) * width + x) * 3;
+            p[0] = static_cast<uint16_t>(65535 * x / (width - 1));
+            p[1] = static_cast<uint16_t>(65535 * y / (height - 1));
+            p[2] = static_cast<uint16_t>(32768);
+        }
+    }
+
+    Magick::Image image;
+    image.read(width, height, "RGB", Magick::ShortPixel, rgb.data());
+    return image;
+}
+
+
+EditHistory::Step pointStep(const char* name, const PointKernel::Op& op) {
+    const EditHistory::Operation apply = [op](Magick::Image& image) {
+        PointKernel kernel;
+        kernel.append(op);
+        kernel.apply(image);
+    };
+    return { name, {}, apply, apply, op };
+}
+
+
+Magick::Image applied(const Magick::Image& base, const EditHistory::Step& step) {
+    Magick::Image result = base;
+    step.apply(result);
+    return result;
+}
+
+
+TEST(EditHistory, ReplaceLastKeepsOneStepPerDrag) {
+    const Magick::Image original = gradient(64, 48);
+    EditHistory history;
+    history.reset(original);
+
+    const EditHistory::Step flop = { "flip", {}, [](Magick::Image& image) { image.flop(); },
+                                     [](Magick::Image& image) { image.flop(); }, std::nullopt };
+    const Magick::Image flopped = applied(original, flop);
+    history.push(flop, flopped, 0);
+
+    // First value stacks on the flop; later values replace it, computed from the flop
+    Magick::Image current = applied(flopped, pointStep("adjustHue", PointKernel::modulate(100, 100, 120)));
+    history.push(pointStep("adjustHue", PointKernel::modulate(100, 100, 120)), current, 0);
+
+    for (double hue : { 140.0, 90.0, 130.0 }) {
+        Magick::Image base;
+        ASSERT_TRUE(history.stateAt(history.position() - 1, base));
+        EXPECT_EQ(pixels(base), pixels(flopped));
+
+        const EditHistory::Step step = pointStep("adjustHue", PointKernel::modulate(100, 100, hue));
+        current = applied(base, step);
+        history.replaceLast(step, current, 0);
+    }
+
+    EXPECT_EQ(history.stepCount(), 2);
+    EXPECT_EQ(history.position(), 2);
+    EXPECT_EQ(pixels(current), pixels(applied(flopped, pointStep("adjustHue", PointKernel::modulate(100, 100, 130)))));
+
+    Magick::Image restored;
+    ASSERT_TRUE(history.undo(restored));
+    EXPECT_EQ(pixels(restored), pixels(flopped));
+    ASSERT_TRUE(history.redo(restored));
+    EXPECT_EQ(pixels(restored), pixels(current));
+}
+
+
+// As with push, a replacement after undo drops the steps that were undone
+TEST(EditHistory, ReplaceLastDropsUndoneSteps) {
+    const Magick::Image original = gradient(32, 32);
+    EditHistory history;
+    history.reset(original);
+
+    const EditHistory::Step gamma = pointStep("adjustGamma", PointKernel::gamma(1.4));
+    const EditHistory::Step hue = pointStep("adjustHue", PointKernel::modulate(100, 100, 120));
+    const Magick::Image first = applied(original, gamma);
+    history.push(gamma, first, 0);
+    history.push(hue, applied(first, hue), 0);
+
+    Magick::Image state;
+    ASSERT_TRUE(history.undo(state));
+    ASSERT_TRUE(history.canRedo());
+
+    const EditHistory::Step gamma2 = pointStep("adjustGamma", PointKernel::gamma(0.8));
+    history.replaceLast(gamma2, applied(original, gamma2), 0);
+
+    EXPECT_EQ(history.stepCount(), 1);
+    EXPECT_FALSE(history.canRedo());
+    EXPECT_EQ(history.step(0).point->gamma, 0.8);
+}
+
+}
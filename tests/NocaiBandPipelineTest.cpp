@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QThreadPool>
+#include <array>
+#include <random>
+#include <vector>
+
+#include "NocaiBandPipeline.h"
+
+
+/*
+    NocaiBandPipeline against the per-pixel code it replaced: classify every pixel, run
+    the original in-place 4x4 promotion over the whole page, pack and lay out the PRN,
+    then compare the file byte for byte. Pages are dense enough that promotions happen
+    at band seams, along the promotion edges (y = 1, y = h - 3, x = w - 3) and across
+    the segments the pool splits a band into.
+*/
+
+namespace {
+
+using DotPage = std::vector<std::vector<uint8_t>>;      // [y][x]
+
+constexpr int MaskSize = 37;                            // Odd, so tiles never line up with bands
+const std::array<int, 4> NocaiOrder = { 2, 1, 0, 3 };
+
+
+struct Page {
+    int width = 0;
+    int height = 0;
+    std::array<std::vector<uint8_t>, 4> masks;          // MaskSize x MaskSize tile per channel
+    std::array<std::vector<uint8_t>, 4> dithered;       // 0 or 255 per pixel, width * height
+
+    std::array<MaskTile, 4> tiles() const {
+        std::array<MaskTile, 4> tiles;
+        for (int ch = 0; ch < 4; ++ch)
+            tiles[ch] = { masks[ch].data(), MaskSize, MaskSize, 5 * ch, 3 * ch };
+        return tiles;
+    }
+};
+
+
+// About 3 in 4 pixels inked: a 4x4 window then holds 12 dots about as often as not
+Page randomPage(int width, int height, unsigned seed) {
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::bernoulli_distribution inked(0.75);
+
+    Page page;
+    page.width = width;
+    page.height = height;
+    for (int ch = 0; ch < 4; ++ch) {
+        page.masks[ch].resize(MaskSize * MaskSize);
+        for (uint8_t& value : page.masks[ch])
+            value = static_cast<uint8_t>(byte(random));
+        page.dithered[ch].resize(static_cast<size_t>(width) * height);
+        for (uint8_t& value : page.dithered[ch])
+            value = inked(random) ? 255 : 0;
+    }
+    return page;
+}
+
+
+// The per-pixel classification and in-place promotion generatePRNNative started from,
+// with the mask looked up by plain modular indexing
+DotPage referenceDots(const Page& page, int ch, int& promotedOnEdges) {
+    const MaskTile tile = page.tiles()[ch];
+    DotPage dots(page.height, std::vector<uint8_t>(page.width, 0));
+
+    for (int y = 0; y < page.height; ++y) {
+        for (int x = 0; x < page.width; ++x) {
+            if (page.dithered[ch][static_cast<size_t>(y) * page.width + x] < 128) continue;
+
+            const int tx = ((x - tile.offsetX) % tile.width + tile.width) % tile.width;
+            const int ty = ((y - tile.offsetY) % tile.height + tile.height) % tile.height;
+            const uint8_t t = tile.data[ty * tile.width + tx];
+            dots[y][x] = t >= 192 ? 1 : t >= 128 ? 2 : 3;
+        }
+    }
+
+    for (int y = 1; y < page.height - 2; ++y) {
+        for (int x = 1; x < page.width - 2; ++x) {
+            if (dots[y][x] == 3) continue;
+
+            int count = 0;
+            for (int dy = -1; dy <= 2; ++dy)
+                for (int dx = -1; dx <= 2; ++dx)
+                    if (dots[y + dy][x + dx] > 0)
+                        ++count;
+
+            if (count >= 12) {
+                dots[y][x] = 3;
+                if (y == 1 || y == page.height - 3 || x == page.width - 3)
+                    ++promotedOnEdges;
+            }
+        }
+    }
+    return dots;
+}
+
+
+std::vector<uint8_t> referencePRN(const Page& page, int xdpi, int ydpi, int& promotedOnEdges) {
+    std::array<DotPage, 4> dots;
+    for (int ch = 0; ch < 4; ++ch)
+        dots[ch] = referenceDots(page, ch, promotedOnEdges);
+
+    const int bytesPerLine = ((page.width + 3) / 4 + 3) / 4 * 4;
+    const uint32_t header[12] = { 0x00005555, uint32_t(xdpi), uint32_t(ydpi), uint32_t(bytesPerLine),
+                                  uint32_t(page.height), uint32_t(page.width), 0, 4, 1, 1, 0, 0 };
+
+    std::vector<uint8_t> prn(reinterpret_cast<const uint8_t*>(header), reinterpret_cast<const uint8_t*>(header + 12));
+    for (int y = 0; y < page.height; ++y) {
+        for (int ch : NocaiOrder) {
+            std::vector<uint8_t> line(bytesPerLine, 0);
+            for (int x = 0; x < page.width; ++x)
+                line[x / 4] |= static_cast<uint8_t>((dots[ch][y][x] & 3) << ((3 - x % 4) * 2));
+            prn.insert(prn.end(), line.begin(), line.end());
+        }
+    }
+    return prn;
+}
+
+
+// Run the pipeline, feeding rows in chunks that vary in size up to bandRows
+std::vector<uint8_t> pipelinePRN(const Page& page, int bandRows, QThreadPool* pool, const QString& path, unsigned seed) {
+    NocaiBandPipeline pipeline;
+    pipeline.setThreadPool(pool);
+    if (!pipeline.begin(path, page.width, page.height, 720, 360, page.tiles(), bandRows))
+        return {};
+
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> chunk(1, bandRows);
+
+    for (int y0 = 0; y0 < page.height;) {
+        const int rows = std::min(chunk(random), page.height - y0);
+
+        std::array<PlaneView, 4> band;
+        for (int ch = 0; ch < 4; ++ch)
+            band[ch] = { const_cast<uint8_t*>(page.dithered[ch].data()) + static_cast<size_t>(y0) * page.width,
+                         page.width, rows, page.width };
+        pipeline.classifyBands(band);
+        if (!pipeline.commitBand())
+            return {};
+        y0 += rows;
+    }
+    if (!pipeline.finish())
+        return {};
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return {};
+    const QByteArray bytes = file.readAll();
+    return std::vector<uint8_t>(bytes.begin(), bytes.end());
+}
+
+
+struct Case {
+    int width;
+    int height;
+    int bandRows;
+    int threads;                // 0 = no pool
+};
+
+void PrintTo(const Case& c, std::ostream* os) {
+    *os << c.width << "x" << c.height << ", bands of " << c.bandRows << ", " << c.threads << " threads";
+}
+
+class NocaiBandPipelineTest : public testing::TestWithParam<Case> {
+protected:
+    QTemporaryDir dir;
+};
+
+
+TEST_P(NocaiBandPipelineTest, MatchesPerPixelPromotion) {
+    const Case c = GetParam();
+    ASSERT_TRUE(dir.isValid());
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(std::max(1, c.threads));
+
+    for (unsigned seed = 1; seed <= 4; ++seed) {
+        const Page page = randomPage(c.width, c.height, seed);
+        int promotedOnEdges = 0;
+        const std::vector<uint8_t> expected = referencePRN(page, 720, 360, promotedOnEdges);
+        const std::vector<uint8_t> actual = pipelinePRN(page, c.bandRows, c.threads ? &pool : nullptr,
+                                                        dir.filePath("page.prn"), seed);
+
+        ASSERT_EQ(actual.size(), expected.size()) << "seed " << seed;
+        ASSERT_TRUE(actual == expected) << "seed " << seed;
+
+        // Large pages must actually exercise the edges of the promotion area
+        if (c.width >= 16 && c.height >= 16) {
+            EXPECT_GT(promotedOnEdges, 0) << "seed " << seed;
+        }
+    }
+}
+
+
+INSTANTIATE_TEST_SUITE_P(Pages, NocaiBandPipelineTest, testing::Values(
+    // Shorter than a band, down to pages with no promotable row
+    Case { 9, 1, 8, 0 }, Case { 9, 2, 8, 0 }, Case { 9, 3, 8, 0 }, Case { 9, 4, 8, 0 }, Case { 9, 7, 8, 0 },
+    // Narrow pages, including ones too narrow to promote
+    Case { 1, 20, 8, 0 }, Case { 3, 20, 8, 0 }, Case { 4, 20, 8, 0 }, Case { 5, 20, 8, 0 },
+    // Band seams on either side of a multiple of the band height
+    Case { 61, 31, 8, 0 }, Case { 61, 32, 8, 0 }, Case { 61, 33, 8, 0 }, Case { 130, 67, 16, 0 },
+    // Bands split into speculative segments and repaired in order
+    Case { 97, 200, 64, 4 }, Case { 257, 131, 32, 3 }, Case { 64, 300, 128, 8 }
+));
+
+}
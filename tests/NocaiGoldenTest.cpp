@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QUrl>
+#include <Magick++.h>
+#include <lcms2.h>
+#include <algorithm>
+#include <cmath>
+
+#include "NocaiBandPipeline.h"
+#include "PrintJobNocai.h"
+
+
+/*
+    generatePRNNative against the script it replaces. Each sample page is run through
+    cmyk_dither_mask.sh with the bundled magick binary, which writes the golden PRN, and
+    through the native pipeline; the two files must be identical byte for byte. Pages
+    are taller than a band and larger than the 512 mask tile both ways, so the masks
+    wrap, and cover untagged RGB, an embedded non-sRGB RGB profile, untagged gray and
+    an embedded gray profile.
+*/
+
+namespace {
+
+// Smooth ramps in every channel plus a little noise, so all ink levels and mask values meet
+Magick::Image samplePage(int width, int height, bool gray) {
+    std::vector<uint16_t> pixels(static_cast<size_t>(width) * height * 3);
+    uint32_t noise = 12345;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            noise = noise * 1664525u + 1013904223u;
+            const int jitter = static_cast<int>(noise >> 24) - 128;
+            uint16_t* p = pixels.data() + (static_cast<size_t>(y) * width + x) * 3;
+            p[0] = static_cast<uint16_t>(std::clamp(65535 * x / std::max(1, width - 1) + jitter, 0, 65535));
+            p[1] = gray ? p[0] : static_cast<uint16_t>(65535 * y / std::max(1, height - 1));
+            p[2] = gray ? p[0] : static_cast<uint16_t>(32768 + 32767 * std::sin(0.05 * (x + y)));
+        }
+    }
+    Magick::Image page;
+    page.read(width, height, "RGB", Magick::ShortPixel, pixels.data());
+    if (gray)
+        page.type(Magick::GrayscaleType);
+    return page;
+}
+
+
+Magick::Blob profileBlob(cmsHPROFILE profile) {
+    cmsUInt32Number size = 0;
+    cmsSaveProfileToMem(profile, nullptr, &size);
+    std::vector<char> data(size);
+    cmsSaveProfileToMem(profile, data.data(), &size);
+    cmsCloseProfile(profile);
+    return Magick::Blob(data.data(), size);
+}
+
+
+// Gamma 1.8 RGB on Adobe-like primaries, far enough from sRGB to move every ink level
+Magick::Blob wideGamutProfile() {
+    cmsCIExyY white;
+    cmsWhitePointFromTemp(&white, 6504);
+    const cmsCIExyYTRIPLE primaries = { { 0.64, 0.33, 1 }, { 0.21, 0.71, 1 }, { 0.15, 0.06, 1 } };
+    cmsToneCurve* curve = cmsBuildGamma(nullptr, 1.8);
+    cmsToneCurve* curves[3] = { curve, curve, curve };
+    cmsHPROFILE profile = cmsCreateRGBProfile(&white, &primaries, curves);
+    cmsFreeToneCurve(curve);
+    return profileBlob(profile);
+}
+
+
+Magick::Blob grayProfile() {
+    cmsToneCurve* curve = cmsBuildGamma(nullptr, 2.2);
+    cmsHPROFILE profile = cmsCreateGrayProfile(cmsD50_xyY(), curve);
+    cmsFreeToneCurve(curve);
+    return profileBlob(profile);
+}
+
+
+QByteArray readAll(const QString& path) {
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+
+struct Sample {
+    const char* name;
+    bool gray;
+    Magick::Blob (*profile)();      // nullptr = untagged
+};
+
+void PrintTo(const Sample& sample, std::ostream* os) { *os << sample.name; }
+
+
+class NocaiGoldenTest : public testing::TestWithParam<Sample> {
+protected:
+    static constexpr int Width = 700;
+    static constexpr int Height = 2 * NocaiBandPipeline::DefaultBandRows + 5;
+
+    QTemporaryDir dir;
+    PrintJobNocai job;
+
+    // Sample page written as PNG, as ScanlineReader streams it
+    QString writeSample() {
+        const Sample sample = GetParam();
+        Magick::Image page = samplePage(Width, Height, sample.gray);
+        if (sample.profile)
+            page.iccColorProfile(sample.profile());
+
+        const QString path = dir.filePath(QString("%1.png").arg(sample.name));
+        page.write(path.toStdString());
+        return path;
+    }
+};
+
+
+TEST_P(NocaiGoldenTest, NativeMatchesScript) {
+    if (!QFile::exists(":/assets/magick"))
+        GTEST_SKIP() << "no bundled magick binary to run the script with";
+    ASSERT_TRUE(dir.isValid());
+
+    const QString image = writeSample();
+    const QString golden = dir.filePath("golden.prn");
+    const QString native = dir.filePath("native.prn");
+
+    job.prepareNocaiAssets();
+    ASSERT_TRUE(job.generatePRNviaScript(image, QUrl::fromLocalFile(golden).toString(), 720, 720));
+    ASSERT_TRUE(job.generatePRNNative(image, QUrl::fromLocalFile(native).toString(), 720, 720));
+
+    const QByteArray expected = readAll(golden);
+    const QByteArray actual = readAll(native);
+    ASSERT_FALSE(expected.isEmpty());
+    ASSERT_EQ(actual.size(), expected.size());
+
+    int mismatch = 0;
+    while (mismatch < expected.size() && actual[mismatch] == expected[mismatch])
+        ++mismatch;
+    EXPECT_EQ(mismatch, expected.size()) << "first difference at byte " << mismatch;
+}
+
+
+// Independent of the script: every sample must at least produce a complete PRN
+TEST_P(NocaiGoldenTest, NativeWritesCompletePRN) {
+    ASSERT_TRUE(dir.isValid());
+
+    const QString image = writeSample();
+    const QString native = dir.filePath("native.prn");
+    ASSERT_TRUE(job.generatePRNNative(image, QUrl::fromLocalFile(native).toString(), 720, 720));
+
+    const int bytesPerLine = ((Width + 3) / 4 + 3) / 4 * 4;
+    EXPECT_EQ(readAll(native).size(), 12 * 4 + 4 * bytesPerLine * Height);
+}
+
+
+INSTANTIATE_TEST_SUITE_P(Pages, NocaiGoldenTest, testing::Values(
+    Sample { "rgb", false, nullptr },
+    Sample { "rgb_gamma18", false, &wideGamutProfile },
+    Sample { "gray", true, nullptr },
+    Sample { "gray_gamma22", true, &grayProfile }
+), [](const testing::TestParamInfo<Sample>& info) { return std::string(info.param.name); });
+
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+#include "NocaiKernels.h"
+
+
+/*
+    Every ISA's kernels against the scalar ones: random rows of every width up to a few
+    vector lengths plus some long odd ones, at unaligned offsets, with guard bytes after
+    the row that no kernel may touch.
+*/
+
+namespace {
+
+using NocaiKernels::Isa;
+
+constexpr int Guard = 64;
+constexpr uint8_t GuardByte = 0xA5;
+constexpr int Offsets[] = { 0, 1, 3, 13 };
+
+std::vector<int> widths() {
+    std::vector<int> widths;
+    for (int width = 1; width <= 300; ++width)
+        widths.push_back(width);
+    for (int width : { 509, 1021, 4099, 8191 })
+        widths.push_back(width);
+    return widths;
+}
+
+
+class NocaiKernelsTest : public testing::TestWithParam<Isa> {
+protected:
+    const NocaiKernels::Table& scalar = NocaiKernels::forIsa(Isa::Scalar);
+    const NocaiKernels::Table* kernels = nullptr;
+    std::mt19937 random { 0x5EED };
+
+    void SetUp() override {
+        kernels = &NocaiKernels::forIsa(GetParam());
+        if (kernels->isa != GetParam())
+            GTEST_SKIP() << NocaiKernels::isaName(GetParam()) << " not supported on this CPU";
+    }
+
+    // Mostly the values the kernels compare against, so every boundary is hit often
+    std::vector<uint8_t> randomRow(size_t count) {
+        static const uint8_t edges[] = { 0, 1, 127, 128, 129, 191, 192, 193, 254, 255 };
+        std::uniform_int_distribution<int> byte(0, 255), pick(0, 2 * std::size(edges) - 1);
+
+        std::vector<uint8_t> row(count);
+        for (uint8_t& value : row) {
+            const int i = pick(random);
+            value = i < int(std::size(edges)) ? edges[i] : static_cast<uint8_t>(byte(random));
+        }
+        return row;
+    }
+
+    static std::vector<uint8_t> guarded(size_t count) { return std::vector<uint8_t>(count + Guard, GuardByte); }
+
+    static void expectGuardIntact(const std::vector<uint8_t>& out, size_t end) {
+        for (size_t i = end; i < out.size(); ++i)
+            ASSERT_EQ(out[i], GuardByte) << "wrote past the row at byte " << i;
+    }
+};
+
+
+TEST_P(NocaiKernelsTest, ThresholdMatchesScalar) {
+    for (int width : widths()) {
+        for (int offset : Offsets) {
+            const std::vector<uint8_t> ink = randomRow(width + offset), mask = randomRow(width + offset);
+            std::vector<uint8_t> expected = guarded(width + offset), actual = guarded(width + offset);
+
+            scalar.threshold(ink.data() + offset, mask.data() + offset, expected.data() + offset, width);
+            kernels->threshold(ink.data() + offset, mask.data() + offset, actual.data() + offset, width);
+
+            ASSERT_EQ(actual, expected) << "width " << width << ", offset " << offset;
+            expectGuardIntact(actual, width + offset);
+        }
+    }
+}
+
+
+TEST_P(NocaiKernelsTest, ClassifyMatchesScalar) {
+    for (int width : widths()) {
+        for (int offset : Offsets) {
+            const std::vector<uint8_t> dithered = randomRow(width + offset), mask = randomRow(width + offset);
+            std::vector<uint8_t> expected = guarded(width + offset), actual = guarded(width + offset);
+
+            scalar.classify(dithered.data() + offset, mask.data() + offset, expected.data() + offset, width);
+            kernels->classify(dithered.data() + offset, mask.data() + offset, actual.data() + offset, width);
+
+            ASSERT_EQ(actual, expected) << "width " << width << ", offset " << offset;
+            expectGuardIntact(actual, width + offset);
+        }
+    }
+}
+
+
+// Dots are normally 0..3, but only the low two bits may count
+TEST_P(NocaiKernelsTest, Pack2bppMatchesScalar) {
+    for (int width : widths()) {
+        for (int offset : Offsets) {
+            const size_t bytes = (width + 3) / 4;
+            const std::vector<uint8_t> dots = randomRow(width + offset);
+            std::vector<uint8_t> expected = guarded(bytes + offset), actual = guarded(bytes + offset);
+
+            scalar.pack2bpp(dots.data() + offset, expected.data() + offset, width);
+            kernels->pack2bpp(dots.data() + offset, actual.data() + offset, width);
+
+            ASSERT_EQ(actual, expected) << "width " << width << ", offset " << offset;
+            expectGuardIntact(actual, bytes + offset);
+        }
+    }
+}
+
+
+// The scalar kernels are the reference; check them once against the rules themselves
+TEST(NocaiKernelsScalar, FollowsTheScreeningRules) {
+    const NocaiKernels::Table& scalar = NocaiKernels::forIsa(Isa::Scalar);
+
+    for (int ink = 0; ink < 256; ++ink) {
+        for (int mask = 0; mask < 256; ++mask) {
+            const uint8_t u = static_cast<uint8_t>(ink), v = static_cast<uint8_t>(mask);
+            uint8_t dithered = 0, dot = 0;
+            scalar.threshold(&u, &v, &dithered, 1);
+            scalar.classify(&dithered, &v, &dot, 1);
+
+            ASSERT_EQ(dithered, ink >= mask ? 255 : 0);
+            ASSERT_EQ(dot, ink < mask ? 0 : mask >= 192 ? 1 : mask >= 128 ? 2 : 3);
+        }
+    }
+
+    const uint8_t dots[] = { 3, 2, 1, 0, 1, 3 };
+    uint8_t packed[2] = {};
+    scalar.pack2bpp(dots, packed, 6);
+    EXPECT_EQ(packed[0], 0b11100100);
+    EXPECT_EQ(packed[1], 0b01110000);
+}
+
+
+INSTANTIATE_TEST_SUITE_P(Isa, NocaiKernelsTest, testing::Values(Isa::SSE2, Isa::AVX2),
+                         [](const testing::TestParamInfo<Isa>& info) { return NocaiKernels::isaName(info.param); });
+
+}
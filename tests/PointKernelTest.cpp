@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+#include <Magick++.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "EditHistory.h"
+#include "PointKernel.h"
+
+
+/*
+    A fused PointKernel run against the ImageMagick calls it replaces, one after the
+    other, and EditHistory replays against applying each step in turn. PointKernel also
+    writes straight through MagickCore, so it has to unshare the image it is given
+    first: copies of that image, such as EditHistory checkpoints and the editor's
+    preview, must never change.
+*/
+
+namespace {
+
+std::vector<uint16_t> pixels(Magick::Image image) {       // By value: Image::write is not const
+    std::vector<uint16_t> rgb(image.columns() * image.rows() * 3);
+    image.write(0, 0, image.columns(), image.rows(), "RGB", Magick::ShortPixel, rgb.data());
+    return rgb;
+}
+
+
+// Taller than a few kernel bands, with every channel varying
+Magick::Image gradient(int width, int height) {
+    std::vector<uint16_t> rgb(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint16_t* p = rgb.data() + (static_cast<size_t>(y) * width + x) * 3;
+            p[0] = static_cast<uint16_t>(65535 * x / (width - 1));
+            p[1] = static_cast<uint16_t>(65535 * y / (height - 1));
+            p[2] = static_cast<uint16_t>(65535 - 65535 * (x + y) / (width + height - 2));
+        }
+    }
+
+    Magick::Image image;
+    image.read(width, height, "RGB", Magick::ShortPixel, rgb.data());
+    return image;
+}
+
+
+EditHistory::Step pointStep(const char* name, const PointKernel::Op& op, int* calls = nullptr) {
+    const EditHistory::Operation apply = [op, calls](Magick::Image& image) {
+        if (calls) ++*calls;
+        PointKernel kernel;
+        kernel.append(op);
+        kernel.apply(image);
+    };
+    return { name, {}, apply, apply, op };
+}
+
+
+// The ImageMagick call an op stands for
+void applyMagick(Magick::Image& image, const PointKernel::Op& op) {
+    if (op.kind == PointKernel::Op::Modulate)
+        image.modulate(op.brightness, op.saturation, op.hue);
+    else
+        image.gamma(op.gamma);
+}
+
+
+int maxDifference(const std::vector<uint16_t>& a, const std::vector<uint16_t>& b) {
+    int difference = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+        difference = std::max(difference, std::abs(int(a[i]) - int(b[i])));
+    return difference;
+}
+
+
+/*
+    ImageMagick stores every intermediate result at its quantum depth, where a fused
+    run keeps floats; steep gamma curves near black amplify that rounding to a few
+    16-bit levels. 16 levels is 0.025% of full scale.
+*/
+constexpr int MagickTolerance = 16;
+
+
+TEST(PointKernel, MatchesImageMagickCalls) {
+    const std::vector<std::vector<PointKernel::Op>> runs = {
+        { PointKernel::modulate(120, 100, 100) },
+        { PointKernel::modulate(100, 140, 100) },
+        { PointKernel::modulate(100, 100, 150) },
+        { PointKernel::modulate(80, 60, 30) },
+        { PointKernel::gamma(1.8) },
+        { PointKernel::gamma(0.6) },
+        { PointKernel::modulate(110, 80, 120), PointKernel::gamma(1.4), PointKernel::modulate(95, 130, 90) },
+        { PointKernel::gamma(0.8), PointKernel::gamma(1.5), PointKernel::modulate(130, 100, 100) },
+    };
+    const Magick::Image original = gradient(131, 2 * PointKernel::BandRows + 7);
+
+    for (size_t r = 0; r < runs.size(); ++r) {
+        PointKernel kernel;
+        Magick::Image expected = original;
+        for (const PointKernel::Op& op : runs[r]) {
+            kernel.append(op);
+            applyMagick(expected, op);
+        }
+
+        Magick::Image fused = original;
+        kernel.apply(fused);
+        EXPECT_LE(maxDifference(pixels(fused), pixels(expected)), MagickTolerance) << "run " << r;
+    }
+}
+
+
+TEST(PointKernel, MergesAdjacentGammas) {
+    PointKernel kernel;
+    kernel.append(PointKernel::gamma(0.8));
+    kernel.append(PointKernel::gamma(1.5));
+    EXPECT_EQ(kernel.size(), 1);
+
+    kernel.append(PointKernel::modulate(110, 100, 100));
+    kernel.append(PointKernel::gamma(1.2));
+    EXPECT_EQ(kernel.size(), 3);
+
+    const Magick::Image original = gradient(64, 64);
+    Magick::Image once = original;
+    once.gamma(0.8 * 1.5);
+    Magick::Image twice = original;
+    PointKernel pair;
+    pair.append(PointKernel::gamma(0.8));
+    pair.append(PointKernel::gamma(1.5));
+    pair.apply(twice);
+    EXPECT_LE(maxDifference(pixels(twice), pixels(once)), 1);
+}
+
+
+// Point steps are fused between the other steps and never run one by one
+TEST(EditHistory, ReplayFusesPointSteps) {
+    const Magick::Image original = gradient(97, 2 * PointKernel::BandRows + 3);
+
+    int pointCalls = 0;
+    const EditHistory::Operation flop = [](Magick::Image& image) { image.flop(); };
+    const std::vector<EditHistory::Step> steps = {
+        pointStep("gamma", PointKernel::gamma(1.3), &pointCalls),
+        pointStep("modulate", PointKernel::modulate(115, 90, 110), &pointCalls),
+        { "flop", {}, flop, flop, std::nullopt },
+        pointStep("gamma", PointKernel::gamma(0.7), &pointCalls),
+        pointStep("gamma", PointKernel::gamma(1.1), &pointCalls),
+    };
+
+    Magick::Image sequential = original;
+    for (const EditHistory::Step& step : steps)
+        step.apply(sequential);
+    ASSERT_EQ(pointCalls, 4);
+    pointCalls = 0;
+
+    std::vector<int> progress;
+    Magick::Image replayed = original;
+    EditHistory::replay(replayed, steps, false, [&](int done) { progress.push_back(done); });
+
+    EXPECT_EQ(pointCalls, 0);
+    EXPECT_EQ(progress, (std::vector<int> { 2, 3, 5 }));
+    EXPECT_LE(maxDifference(pixels(replayed), pixels(sequential)), MagickTolerance);
+}
+
+
+TEST(PointKernel, LeavesCopiesUntouched) {
+    const Magick::Image original = gradient(97, 3 * PointKernel::BandRows + 5);
+    const std::vector<uint16_t> before = pixels(original);
+
+    PointKernel kernel;
+    kernel.append(PointKernel::gamma(1.8));
+    kernel.append(PointKernel::modulate(110, 80, 100));
+
+    Magick::Image edited = original;
+    kernel.apply(edited);
+
+    EXPECT_EQ(pixels(original), before);
+    EXPECT_NE(pixels(edited), before);
+}
+
+
+// As ImageEditor does it: each edit runs on the current state, which the last checkpoint shares
+TEST(PointKernel, KeepsEditHistoryCheckpoints) {
+    const Magick::Image original = gradient(97, 3 * PointKernel::BandRows + 5);
+    const std::vector<uint16_t> originalPixels = pixels(original);
+
+    EditHistory history;
+    history.reset(original);
+
+    // Slow enough to be kept as a checkpoint, which then shares pixels with current
+    Magick::Image current = original;
+    const EditHistory::Step brighten = pointStep("modulate", PointKernel::modulate(120, 100, 100));
+    brighten.apply(current);
+    history.push(brighten, current, EditHistory::CheckpointCostMs);
+    const std::vector<uint16_t> brightened = pixels(current);
+    ASSERT_NE(brightened, originalPixels);
+
+    const EditHistory::Step darken = pointStep("gamma", PointKernel::gamma(0.6));
+    darken.apply(current);
+    history.push(darken, current, 0);
+    ASSERT_NE(pixels(current), brightened);
+
+    Magick::Image restored;
+    ASSERT_TRUE(history.undo(restored));
+    EXPECT_EQ(pixels(restored), brightened);
+    ASSERT_TRUE(history.undo(restored));
+    EXPECT_EQ(pixels(restored), originalPixels);
+}
+
+}
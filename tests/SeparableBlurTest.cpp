@@ -0,0 +1,287 @@
+#include <gtest/gtest.h>
+#include <Magick++.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "SeparableBlur.h"
+
+
+/*
+    SeparableBlur on pages of several tiles (700x300 is 2 x 3 tiles) in gray, RGB and
+    CMYK, against direct 2-D convolutions with edge virtual pixels: the outer product of
+    blurTaps for blur, and SharpenImage's own kernel for sharpen. Both are also checked
+    against Image::blur and Image::sharpen themselves, Gaussian and boxes alike. Every
+    ISA must give the same bits, and an image sharing pixels with the one filtered must
+    not change. The image's progress monitor sees every tile, and aborts the filter when
+    it refuses.
+*/
+
+namespace {
+
+using SeparableBlur::Isa;
+
+constexpr int Width = 700;
+constexpr int Height = 300;
+constexpr double Pi = 3.141592653589793;      // MagickPI
+
+// Against ImageMagick: SeparableBlur::GaussianTolerance, and BoxTolerance for boxes,
+// whose worst sample on these pages is about 0.006 off
+constexpr double BoxSigma = 20.0;               // Past BoxSigmaThreshold, so Auto uses boxes
+constexpr double ClippingRadius = 10.0;         // Well inside BoxSigma's kernel
+
+
+struct Case {
+    const char* map;            // "I", "RGB" or "CMYK"; sets the colour space on read
+    double sigma;
+};
+
+void PrintTo(const Case& c, std::ostream* os) { *os << c.map << ", sigma " << c.sigma; }
+
+
+int channelCount(const char* map) { return static_cast<int>(std::string(map).size()); }
+
+
+// Smooth waves with blocks of noise, so both flat and busy areas straddle tile seams
+Magick::Image samplePage(const char* map) {
+    const int channels = channelCount(map);
+    std::vector<float> values(static_cast<size_t>(Width) * Height * channels);
+    uint32_t noise = 0x5EED;
+    for (int y = 0; y < Height; ++y) {
+        for (int x = 0; x < Width; ++x) {
+            for (int k = 0; k < channels; ++k) {
+                noise = noise * 1664525u + 1013904223u;
+                float value = 0.5f + 0.4f * std::sin(x * 0.05f + k) * std::cos(y * 0.03f);
+                if ((x / 7 + y / 5) % 3 == 0)
+                    value = (noise >> 8) / 16777216.0f;
+                values[(static_cast<size_t>(y) * Width + x) * channels + k] = value;
+            }
+        }
+    }
+
+    Magick::Image image;
+    image.read(Width, Height, map, Magick::FloatPixel, values.data());
+    return image;
+}
+
+
+std::vector<float> pixels(Magick::Image image, const char* map) {         // By value: Image::write is not const
+    std::vector<float> values(image.columns() * image.rows() * channelCount(map));
+    image.write(0, 0, image.columns(), image.rows(), map, Magick::FloatPixel, values.data());
+    return values;
+}
+
+
+// n x n kernel over the page, reading past the edges as edge virtual pixels do
+std::vector<float> convolve(const std::vector<float>& src, int channels, const std::vector<double>& kernel, int n) {
+    std::vector<float> dst(src.size());
+    const int j = (n - 1) / 2;
+    for (int y = 0; y < Height; ++y) {
+        for (int x = 0; x < Width; ++x) {
+            for (int k = 0; k < channels; ++k) {
+                double sum = 0.0;
+                for (int v = -j; v <= j; ++v) {
+                    const int sy = std::clamp(y + v, 0, Height - 1);
+                    for (int u = -j; u <= j; ++u) {
+                        const int sx = std::clamp(x + u, 0, Width - 1);
+                        sum += kernel[(v + j) * n + u + j] * src[(static_cast<size_t>(sy) * Width + sx) * channels + k];
+                    }
+                }
+                dst[(static_cast<size_t>(y) * Width + x) * channels + k] = static_cast<float>(sum);
+            }
+        }
+    }
+    return dst;
+}
+
+
+// Largest difference, clamped to [0, 1] first since non-HDRI builds clamp on import
+double maxError(const std::vector<float>& a, const std::vector<float>& b) {
+    double error = 0.0;
+    for (size_t i = 0; i < a.size(); ++i)
+        error = std::max(error, std::fabs(std::clamp(double(a[i]), 0.0, 1.0) - std::clamp(double(b[i]), 0.0, 1.0)));
+    return error;
+}
+
+
+// Counts calls and refuses from call number refuseAt (0-based), as a cancelled editor job does
+struct Monitor {
+    std::atomic_int calls { 0 };
+    int refuseAt = -1;
+    MagickCore::MagickSizeType extent = 0;
+
+    static MagickCore::MagickBooleanType call(const char*, MagickCore::MagickOffsetType,
+                                              MagickCore::MagickSizeType extent, void* data) {
+        Monitor* monitor = static_cast<Monitor*>(data);
+        monitor->extent = extent;
+        const int call = monitor->calls++;
+        return monitor->refuseAt >= 0 && call >= monitor->refuseAt ? MagickCore::MagickFalse : MagickCore::MagickTrue;
+    }
+};
+
+
+class SeparableBlurTest : public testing::TestWithParam<Case> {
+protected:
+    const char* map = GetParam().map;
+    const int channels = channelCount(GetParam().map);
+    const double sigma = GetParam().sigma;
+    const Magick::Image source = samplePage(GetParam().map);
+};
+
+
+TEST_P(SeparableBlurTest, BlurMatches2DKernel) {
+    const std::vector<float> taps = SeparableBlur::blurTaps(0.0, sigma);
+    const int n = static_cast<int>(taps.size());
+    std::vector<double> kernel(static_cast<size_t>(n) * n);
+    for (int v = 0; v < n; ++v)
+        for (int u = 0; u < n; ++u)
+            kernel[v * n + u] = double(taps[v]) * taps[u];
+
+    Magick::Image blurred = source;
+    ASSERT_TRUE(SeparableBlur::blur(blurred, 0.0, sigma, SeparableBlur::Mode::Gaussian));
+
+    EXPECT_LT(maxError(pixels(blurred, map), convolve(pixels(source, map), channels, kernel, n)), 2e-5);
+}
+
+
+// SharpenImage's kernel as effect.c builds it: a negated 2-D Gaussian, centre set to
+// -2 x its sum, normalised
+TEST_P(SeparableBlurTest, SharpenMatchesSharpenImageKernel) {
+    const int n = static_cast<int>(SeparableBlur::sharpenTaps(0.0, sigma).size());
+    const int j = (n - 1) / 2;
+    std::vector<double> kernel(static_cast<size_t>(n) * n);
+    double normalize = 0.0;
+    for (int v = -j; v <= j; ++v) {
+        for (int u = -j; u <= j; ++u) {
+            double& value = kernel[(v + j) * n + u + j];
+            value = -std::exp(-(double(u) * u + double(v) * v) / (2.0 * sigma * sigma)) / (2.0 * Pi * sigma * sigma);
+            normalize += value;
+        }
+    }
+    kernel[kernel.size() / 2] = -2.0 * normalize;
+    normalize = 0.0;
+    for (double value : kernel)
+        normalize += value;
+    for (double& value : kernel)
+        value /= normalize;
+
+    Magick::Image sharpened = source;
+    ASSERT_TRUE(SeparableBlur::sharpen(sharpened, 0.0, sigma));
+
+    EXPECT_LT(maxError(pixels(sharpened, map), convolve(pixels(source, map), channels, kernel, n)), 5e-5);
+}
+
+
+TEST_P(SeparableBlurTest, BlurMatchesImageMagick) {
+    Magick::Image blurred = source, expected = source;
+    ASSERT_TRUE(SeparableBlur::blur(blurred, 0.0, sigma, SeparableBlur::Mode::Gaussian));
+    expected.blur(0.0, sigma);
+
+    EXPECT_LE(maxError(pixels(blurred, map), pixels(expected, map)), SeparableBlur::GaussianTolerance);
+}
+
+
+TEST_P(SeparableBlurTest, SharpenMatchesImageMagick) {
+    Magick::Image sharpened = source, expected = source;
+    ASSERT_TRUE(SeparableBlur::sharpen(sharpened, 0.0, sigma));
+    expected.sharpen(0.0, sigma);
+
+    EXPECT_LE(maxError(pixels(sharpened, map), pixels(expected, map)), SeparableBlur::GaussianTolerance);
+}
+
+
+TEST_P(SeparableBlurTest, IsasGiveIdenticalResults) {
+    const SeparableBlur::Table& scalar = SeparableBlur::forIsa(Isa::Scalar);
+    Magick::Image expectedBlur = source, expectedSharpen = source;
+    ASSERT_TRUE(SeparableBlur::blur(expectedBlur, 0.0, sigma, SeparableBlur::Mode::Gaussian,
+                                    QThreadPool::globalInstance(), scalar));
+    ASSERT_TRUE(SeparableBlur::sharpen(expectedSharpen, 0.0, sigma, QThreadPool::globalInstance(), scalar));
+
+    for (Isa isa : { Isa::SSE2, Isa::AVX2 }) {
+        const SeparableBlur::Table& kernels = SeparableBlur::forIsa(isa);
+        if (kernels.isa != isa)
+            continue;       // Not supported on this CPU
+
+        Magick::Image blurred = source, sharpened = source;
+        ASSERT_TRUE(SeparableBlur::blur(blurred, 0.0, sigma, SeparableBlur::Mode::Gaussian,
+                                        QThreadPool::globalInstance(), kernels));
+        ASSERT_TRUE(SeparableBlur::sharpen(sharpened, 0.0, sigma, QThreadPool::globalInstance(), kernels));
+
+        EXPECT_TRUE(pixels(blurred, map) == pixels(expectedBlur, map)) << NocaiKernels::isaName(isa);
+        EXPECT_TRUE(pixels(sharpened, map) == pixels(expectedSharpen, map)) << NocaiKernels::isaName(isa);
+    }
+}
+
+
+// The filtered image shares its pixels with source until it is written
+TEST_P(SeparableBlurTest, LeavesSharedImagesUntouched) {
+    const std::vector<float> before = pixels(source, map);
+
+    Magick::Image blurred = source;
+    ASSERT_TRUE(SeparableBlur::blur(blurred, 0.0, sigma, SeparableBlur::Mode::Box));
+    EXPECT_TRUE(pixels(source, map) == before);
+
+    Magick::Image sharpened = source;
+    ASSERT_TRUE(SeparableBlur::sharpen(sharpened, 0.0, sigma));
+    EXPECT_TRUE(pixels(source, map) == before);
+}
+
+
+TEST_P(SeparableBlurTest, ReportsTilesToProgressMonitor) {
+    Monitor monitor;
+    Magick::Image blurred = source;
+    blurred.modifyImage();
+    MagickCore::SetImageProgressMonitor(blurred.image(), &Monitor::call, &monitor);
+    ASSERT_TRUE(SeparableBlur::blur(blurred, 0.0, sigma, SeparableBlur::Mode::Gaussian));
+
+    const int tiles = (Width + SeparableBlur::TileColumns - 1) / SeparableBlur::TileColumns
+                      * ((Height + SeparableBlur::TileRows - 1) / SeparableBlur::TileRows);
+    EXPECT_EQ(monitor.calls, tiles);
+    EXPECT_EQ(monitor.extent, MagickCore::MagickSizeType(tiles));
+}
+
+
+TEST_P(SeparableBlurTest, MonitorRefusalAbortsUntouched) {
+    const std::vector<float> before = pixels(source, map);
+
+    for (int refuseAt : { 0, 2 }) {
+        Monitor monitor;
+        monitor.refuseAt = refuseAt;
+        Magick::Image sharpened = source;
+        sharpened.modifyImage();
+        MagickCore::SetImageProgressMonitor(sharpened.image(), &Monitor::call, &monitor);
+        EXPECT_THROW(SeparableBlur::sharpen(sharpened, 0.0, sigma), Magick::ErrorMonitor) << refuseAt;
+        EXPECT_TRUE(pixels(sharpened, map) == before) << refuseAt;
+    }
+}
+
+
+INSTANTIATE_TEST_SUITE_P(Pages, SeparableBlurTest, testing::Values(
+    Case { "I", 1.0 }, Case { "RGB", 1.0 }, Case { "CMYK", 1.0 },
+    Case { "I", 3.0 }, Case { "RGB", 3.0 }, Case { "CMYK", 3.0 }
+));
+
+
+// Auto switches to boxes for a large sigma with no radius, and stays Gaussian when a
+// radius clips the kernel
+TEST(SeparableBlur, AutoMatchesImageMagick) {
+    for (const char* map : { "I", "RGB", "CMYK" }) {
+        const Magick::Image source = samplePage(map);
+
+        Magick::Image automatic = source, boxes = source, expected = source;
+        ASSERT_TRUE(SeparableBlur::blur(automatic, 0.0, BoxSigma));
+        ASSERT_TRUE(SeparableBlur::blur(boxes, 0.0, BoxSigma, SeparableBlur::Mode::Box));
+        expected.blur(0.0, BoxSigma);
+        EXPECT_TRUE(pixels(automatic, map) == pixels(boxes, map)) << map;
+        EXPECT_LE(maxError(pixels(automatic, map), pixels(expected, map)), SeparableBlur::BoxTolerance) << map;
+
+        Magick::Image clipped = source, clippedExpected = source;
+        ASSERT_TRUE(SeparableBlur::blur(clipped, ClippingRadius, BoxSigma));
+        clippedExpected.blur(ClippingRadius, BoxSigma);
+        EXPECT_LE(maxError(pixels(clipped, map), pixels(clippedExpected, map)), SeparableBlur::GaussianTolerance) << map;
+    }
+}
+
+}
@@ -0,0 +1,24 @@
+#include <gtest/gtest.h>
+#include <QCoreApplication>
+#include <Magick++.h>
+
+
+/****************************************************************************
+    Unit tests for ripcore and the editor's image code (GoogleTest).
+
+        rip_tests --gtest_filter=NocaiKernels*     one suite
+        ctest --test-dir <build>                   everything, one test each
+
+    Tests that need the bundled assets read them from the qrc resources
+    linked in through ripcore, as the app does.
+****************************************************************************/
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("rip_tests");
+    Magick::InitializeMagick(*argv);
+
+    return RUN_ALL_TESTS();
+}